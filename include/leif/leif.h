@@ -51,14 +51,47 @@ typedef struct {
     uint32_t width, height;
 } LfTexture;
 
+// Glyph of a font, positions are relative to the pen on the baseline. The metrics are queried on first 
+// use, the bitmap is rasterized into the shared glyph atlas the first time the glyph is drawn.
 typedef struct {
-    void* cdata;
-    void* font_info;
-    uint32_t tex_width, tex_height;
+    float xoff, yoff, width, height;
+    float s0, t0, s1, t1; // Normalized texture coordinates within the atlas while rasterized
+    float advance;
+    uint32_t codepoint;
+    bool loaded; // The metrics were queried
+    bool present; // False if the font has no glyph for the code point
+    uint16_t shelf; // Atlas shelf + 1 holding the bitmap, 0 if not rasterized
+} LfGlyph;
+
+#define LF_GLYPH_PAGE_SIZE 256
+#define LF_SDF_SIZE 48
+#define LF_GLYPH_PAGE_COUNT (0x110000 / LF_GLYPH_PAGE_SIZE)
+
+typedef struct {
+    uint32_t id; // Owner of glyphs in the shared atlas & the text layout cache
+    void* face; // Font file shared by all fonts loaded from it
+    void* font_info; // stb_truetype info of the face
+    uint32_t tex_width, tex_height; // Size of the shared glyph atlas
     uint32_t line_gap_add, font_size;
-    LfTexture bitmap;
+    LfTexture bitmap; // The shared glyph atlas
 
     uint32_t num_glyphs;
+    float scale; // stb_truetype scale the glyphs are rasterized at
+    float render_scale; // font_size / rasterized size, glyph metrics are multiplied by it
+    float mono_advance; // Advance of every printable ASCII character (like scale), 0 for proportional fonts
+
+    // SDF fonts store distance fields that are drawn at any size, views share the glyphs of another font
+    bool sdf, view;
+
+    // Glyphs by code point in pages of LF_GLYPH_PAGE_SIZE, pages are allocated on first use
+    LfGlyph** glyph_pages;
+
+    // Glyphs rasterized by earlier runs, mapped from the on-disk glyph cache
+    void* glyph_cache;
+
+    // Metrics in pixels at font_size
+    float max_char_height; // Height of the bitmap box of 'p'
+    float ascent, descent, line_gap;
 } LfFont;
 
 typedef enum {
@@ -94,6 +127,38 @@ typedef struct {
     bool retain_height;
 } LfInputField;
 
+// Large read-only text (like a log) of which only the lines within the scroll window of the 
+// current div are laid out. The text in buf may only be appended to, the line index is extended 
+// by the new bytes every frame. Lines can also be fetched through get_line instead of buf.
+typedef struct {
+    const char* buf;
+    size_t len;
+
+    const char* (*get_line)(void* user_data, uint32_t line, uint32_t* len);
+    void* user_data;
+    uint32_t line_count; // Lines available through get_line
+
+    // Start of every LF_TEXT_VIEW_INDEX_STRIDE'th line in buf, managed by leif
+    size_t* _index;
+    uint32_t _index_count, _index_cap;
+    uint32_t _newlines;
+    size_t _indexed_len;
+} LfTextView;
+
+typedef struct {
+    uint32_t codepoint; // 0 for an empty cell
+    LfColor fg, bg; // Backgrounds with an alpha of 0 are not drawn
+} LfCharCell;
+
+// Grid of fixed size character cells (like a terminal or a hex view), cells holds rows * cols cells 
+// row by row. Rows keep their instances across frames, only rows whose cells changed are built again.
+typedef struct {
+    uint32_t cols, rows;
+    LfCharCell* cells;
+
+    void* _cache; // Managed by leif, released with lf_char_grid_free()
+} LfCharGrid;
+
 typedef struct {
     void* val;
     int32_t handle_pos;
@@ -156,8 +221,171 @@ typedef struct {
 
 typedef void (*LfMenuItemCallback)(uint32_t*);
 
+// --- Rendering ---
+// Every frame is recorded into a LfDrawList between lf_begin() and lf_end(), 
+// lf_end() hands the list to the render backend leif was initialized with.
+#define LF_MAX_TEX_SLOTS 31
+#define LF_NO_TEXTURE 0xFFFF
+#define LF_TEX_LAYER_BIT 0x8000
+#define LF_FIXED_POINT_SCALE 16.0f
+
+// Every instance is shaded by the cheapest pipeline that can draw it
+typedef enum {
+    LF_PIPELINE_SOLID = 0, // Flat rects
+    LF_PIPELINE_SHAPE, // Rounded and/or bordered rects
+    LF_PIPELINE_GLYPH, // Text (samples the coverage of the font atlas)
+    LF_PIPELINE_IMAGE, // Textured quads, optionally rounded and/or bordered
+    LF_PIPELINE_GLYPH_SDF, // Text of SDF fonts (thresholds the distance field of the font atlas)
+    LF_PIPELINE_COUNT
+} LfPipeline;
+
+// One instance per rendered quad (rect, glyph or image)
+typedef struct {
+    float pos[2]; // Top left in px
+    float size[2]; // In px
+    uint16_t texcoords[4]; // s0, t0, s1, t1 normalized to 0 - 65535
+    uint8_t color[4];
+    uint8_t border_color[4];
+    uint16_t tex_index; // Slot in the texture table of the command, LF_TEX_LAYER_BIT | layer or LF_NO_TEXTURE
+    uint16_t corner_radius; // In 1/LF_FIXED_POINT_SCALE px
+    uint16_t border_width; // In 1/LF_FIXED_POINT_SCALE px
+    uint16_t flags; // LfPipeline of the instance
+    uint16_t clip_index; // Clipping area in LfDrawList.clips
+} LfDrawInstance;
+
+typedef struct {
+    uint32_t first_instance, instance_count;
+    uint32_t first_texture, texture_count; // Range in LfDrawList.textures
+    LfPipeline pipeline; // Commands are split into runs of one pipeline in lf_end()
+} LfDrawCmd;
+
+typedef struct {
+    LfDrawInstance* instances;
+    uint32_t instance_count, instance_cap;
+
+    LfDrawCmd* cmds;
+    uint32_t cmd_count, cmd_cap;
+
+    LfTexture* textures;
+    uint32_t texture_count, texture_cap;
+
+    // Pixels whose center lies outside of the clipping area of their instance are not drawn,
+    // the first entry covers the whole display
+    LfAABB* clips;
+    uint32_t clip_count, clip_cap;
+
+    uint32_t display_width, display_height;
+
+    uint32_t pipeline_counts[LF_PIPELINE_COUNT]; // Instances per pipeline
+} LfDrawList;
+
+// Why instances had to be split into another draw command or submission
+typedef enum {
+    LF_FLUSH_INSTANCE_CAPACITY = 0, // The instance buffer of the backend was full
+    LF_FLUSH_TEXTURE_SLOTS, // All LF_MAX_TEX_SLOTS texture slots of a command were in use
+    LF_FLUSH_PIPELINE, // Switch to another pipeline
+    LF_FLUSH_END_OF_FRAME, // lf_end()
+    LF_FLUSH_REASON_COUNT
+} LfFlushReason;
+
+typedef struct {
+    uint32_t drawcalls;
+    uint32_t draw_cmds; // Commands of the draw list
+    uint32_t instances, vertices; // Every instance is a quad of 4 vertices
+    uint64_t upload_bytes; // Instance & clip data uploaded by the backend
+    uint32_t flushes[LF_FLUSH_REASON_COUNT];
+    uint32_t culled; // Primitives that were culled or clipped away before being recorded
+    uint32_t glyphs; // Glyphs emitted by text rendering
+    uint32_t heap_allocs; // Heap allocations made by leif, 0 for a steady state frame
+    uint64_t arena_bytes; // Scratch memory used from the frame arena
+    uint32_t text_cache_hits, text_cache_misses; // Lookups of the text layout cache
+    uint64_t text_cache_bytes; // Memory held by the text layout cache at the end of the frame
+    uint32_t glyphs_rasterized; // Glyphs rasterized into the glyph atlas
+    uint32_t atlas_evictions; // Atlas shelves evicted to make room for new glyphs
+    uint64_t atlas_upload_bytes; // Glyph atlas data uploaded to the backend
+    double cpu_time; // Seconds from the start of lf_begin() to the end of lf_end()
+} LfFrameStats;
+
+typedef struct {
+    const char* name;
+    void* user_data;
+
+    bool (*init)(void* user_data, uint32_t display_width, uint32_t display_height);
+    void (*terminate)(void* user_data);
+    void (*resize)(void* user_data, uint32_t display_width, uint32_t display_height);
+    void (*render)(void* user_data, const LfDrawList* list);
+
+    // Single channel textures (the glyph atlas) are sampled with the value in every channel
+    void (*create_texture)(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                           LfTextureFiltering filter, bool clamp);
+    void (*delete_texture)(void* user_data, LfTexture* tex);
+
+    // Optional, returns true if the texture is stored as a layer of a shared image array (uv_max = extent of the image in it)
+    bool (*texture_layer)(void* user_data, uint32_t tex_id, uint16_t* layer, vec2s* uv_max);
+
+    // Optional, replaces a region of a texture (used for the glyph atlas, without it glyphs are not drawn)
+    void (*update_texture)(void* user_data, LfTexture* tex, uint32_t x, uint32_t y, uint32_t width, uint32_t height, 
+                           const unsigned char* data, int32_t channels);
+
+    // Optional, hands out storage for the count instances of the frame (e.g. a mapped instance buffer). 
+    // lf_end() writes the frame grouped by pipeline straight into it & LfDrawList.instances points 
+    // to it until the next lf_begin() (it may be write only memory). NULL keeps them in memory of leif.
+    LfDrawInstance* (*instance_storage)(void* user_data, uint32_t count);
+} LfRenderBackend;
+
+// What heap memory of leif is used for
+typedef enum {
+    LF_MEM_GENERAL = 0, // Stacks, callback tables & other state
+    LF_MEM_FONTS, // Font files, glyph data & atlases
+    LF_MEM_TEXTURE_STAGING, // Decoded & resized image data
+    LF_MEM_BATCH, // Draw list & pipeline batches
+    LF_MEM_FRAME_SCRATCH, // Frame arena
+    LF_MEM_BACKEND, // Buffers of the render backends
+    LF_MEM_TEXT_CACHE, // Text layouts kept across frames
+    LF_MEM_CATEGORY_COUNT
+} LfMemCategory;
+
+// Every heap allocation of leif (including stb_image, stb_truetype & stb_image_resize) goes through this
+typedef struct {
+    void* (*alloc)(void* user_data, size_t size);
+    void* (*realloc)(void* user_data, void* ptr, size_t old_size, size_t new_size);
+    void (*free)(void* user_data, void* ptr, size_t size);
+    void* user_data;
+} LfAllocator;
+
+// Runtime configuration of leif, fields that are 0 use their default
+typedef struct {
+    uint32_t display_width, display_height;
+
+    // Without a backend the OpenGL backend is used, glfw_window (requires LF_GLFW) installs the input callbacks
+    LfRenderBackend backend;
+    void* glfw_window;
+
+    uint32_t batch_capacity; // Instances per batch of the backend (default 65536)
+    uint32_t tex_slots; // Texture slots per draw command (default & maximum LF_MAX_TEX_SLOTS)
+    uint32_t stack_capacity; // Initial capacity of the style & clip stacks (default 4)
+    uint32_t font_atlas_width, font_atlas_height; // Size of the glyph atlas shared by all fonts (default 1024)
+    size_t frame_arena_size; // Initial size of the per frame scratch arena, grows if a frame needs more (default 64KB)
+    size_t text_cache_capacity; // Memory cap of the text layout cache (default 2MB)
+    bool disable_glyph_cache; // Don't read or write rasterized glyphs in ~/.leif/cache
+
+    // Maximum number of user callbacks per event type (default 4)
+    uint32_t key_callbacks, mouse_button_callbacks, scroll_callbacks, cursor_pos_callbacks;
+} LfConfig;
+
+// Has to be called while leif holds no memory (before lf_init_ex() or after lf_terminate() and freeing all 
+// fonts & texture data), NULL restores malloc, realloc & free
+bool lf_set_allocator(const LfAllocator* allocator);
+
+// Bytes currently allocated by leif in the given category
+size_t lf_get_memory_usage(LfMemCategory category);
+
+void lf_init_ex(const LfConfig* config);
+
 void lf_init_glfw(uint32_t display_width, uint32_t display_height, void* glfw_window);
 
+void lf_init_headless(uint32_t display_width, uint32_t display_height, LfRenderBackend backend);
+
 void lf_terminate();
 
 LfTheme lf_default_theme();
@@ -170,8 +398,22 @@ void lf_resize_display(uint32_t display_width, uint32_t display_height);
 
 LfFont lf_load_font(const char* filepath, uint32_t size);
 
+// All fonts share one glyph atlas (see LfConfig), bitmap_w & bitmap_h are ignored
 LfFont lf_load_font_ex(const char* filepath, uint32_t size, uint32_t bitmap_w, uint32_t bitmap_h);
 
+// Loads a font whose glyphs are stored once as signed distance fields (at LF_SDF_SIZE) & scaled to any size
+LfFont lf_load_font_sdf(const char* filepath, uint32_t size);
+
+// Loads a font from a font file in memory (e.g. embedded into the executable), 
+// the memory is not copied & has to stay valid until all fonts loaded from it are freed
+LfFont lf_load_font_from_memory(const void* data, size_t data_size, uint32_t size);
+
+LfFont lf_load_font_sdf_from_memory(const void* data, size_t data_size, uint32_t size);
+
+// Returns a view of an SDF font that draws at another size without rasterizing anything again.
+// Views are freed with lf_free_font() (which is a no-op for them) & have to be dropped before their font.
+LfFont lf_font_view(const LfFont* font, uint32_t size);
+
 LfTexture lf_load_texture(const char* filepath, bool flip, LfTextureFiltering filter);
 
 LfTexture lf_load_texture_resized(const char* filepath, bool flip, LfTextureFiltering filter, uint32_t w, uint32_t h);
@@ -208,6 +450,10 @@ void lf_create_texture_from_image_data(LfTextureFiltering filter, uint32_t* id,
 
 void lf_free_texture(LfTexture* tex);
 
+// Frees data returned by the lf_load_texture_data* functions
+void lf_free_texture_data(unsigned char* data);
+
+// Font files are released once the last font loaded from them is freed
 void lf_free_font(LfFont* font);
 
 LfFont lf_load_font_asset(const char* asset_name, const char* file_extension, uint32_t font_size);
@@ -398,6 +644,24 @@ void lf_text(const char* text);
 
 void lf_text_wide(const wchar_t* text);
 
+void lf_textf(const char* fmt, ...);
+
+// Lines are not wrapped, the view takes the remaining width of the div
+void lf_text_view(LfTextView* view);
+
+// Releases the line index, the view is indexed from the start again when it is used next
+void lf_text_view_free(LfTextView* view);
+
+// Cells are the advance of the current font wide (of 'M' for proportional fonts) & a line high
+void lf_char_grid(LfCharGrid* grid);
+
+void lf_char_grid_free(LfCharGrid* grid);
+
+// Scratch memory that stays valid until the next lf_begin()
+void* lf_frame_alloc(size_t size);
+
+char* lf_frame_sprintf(const char* fmt, ...);
+
 void lf_set_text_wrap(bool wrap);
 
 LfDiv lf_get_current_div();
@@ -428,6 +692,18 @@ void lf_push_font(LfFont* font);
 
 void lf_pop_font();
 
+// Laid out text for caret placement, valid until the next lf_begin()
+typedef struct LfTextLayout LfTextLayout;
+
+// Lays out str like lf_text_render() does with a wrap_point of wrap_width (-1 = no wrapping) past the origin
+const LfTextLayout* lf_text_layout(const char* str, const LfFont* font, float wrap_width);
+
+// Code point index of the caret closest to x, y (relative to the top left of the text), O(log n)
+int32_t lf_text_hit_test(const LfTextLayout* layout, float x, float y);
+
+// Top left of the caret before the code point at index, relative to the top left of the text
+vec2s lf_text_index_to_pos(const LfTextLayout* layout, int32_t index);
+
 LfTextProps lf_text_render(vec2s pos, const char* str, LfFont font, LfColor color, 
         int32_t wrap_point, vec2s stop_point, bool no_render, bool render_solid, int32_t start_index, int32_t end_index);
 
@@ -476,6 +752,11 @@ void lf_unset_cull_end_x();
 
 void lf_unset_cull_end_y();
 
+// Clips everything rendered until the matching pop to the intersection of rect & the current clipping area
+void lf_push_clip_rect(LfAABB rect);
+
+void lf_pop_clip_rect();
+
 void lf_set_image_color(LfColor color);
 
 void lf_unset_image_color();
@@ -521,3 +802,33 @@ void lf_set_clipboard_text(const char* text);
 char* lf_get_clipboard_text();
 
 void lf_set_no_render(bool no_render);
+
+uint64_t lf_get_frame_upload_bytes();
+
+// Statistics of the last frame that was completed with lf_end()
+LfFrameStats lf_get_frame_stats();
+
+// Least recently used layouts are evicted above the capacity, 0 disables the text layout cache
+void lf_set_text_cache_capacity(size_t bytes);
+
+void lf_clear_text_cache();
+
+bool lf_vertex_streaming_enabled();
+
+LfRenderBackend lf_gl_backend();
+
+LfRenderBackend lf_null_backend();
+
+const LfDrawList* lf_get_draw_list();
+
+uint32_t lf_get_pipeline_instance_count(LfPipeline pipeline);
+
+// The software backend shades on the CPU into a RGBA8 framebuffer 
+// (thread_count = 0 uses one thread per core)
+LfRenderBackend lf_software_backend(uint32_t thread_count);
+
+void lf_software_set_clear_color(LfColor color);
+
+const uint8_t* lf_software_get_framebuffer(uint32_t* width, uint32_t* height);
+
+bool lf_software_write_png(const char* filepath);
@@ -3,6 +3,19 @@
 #include <cglm/types-struct.h>
 #include <glad/glad.h>
 #include <time.h>
+
+// The stb libraries allocate through the allocator of leif
+static void*                    mem_alloc(size_t size, LfMemCategory category);
+static void*                    mem_realloc(void* ptr, size_t size, LfMemCategory category);
+static void                     mem_free(void* ptr);
+#define STBI_MALLOC(sz)                     mem_alloc(sz, LF_MEM_TEXTURE_STAGING)
+#define STBI_REALLOC(p, newsz)              mem_realloc(p, newsz, LF_MEM_TEXTURE_STAGING)
+#define STBI_FREE(p)                        mem_free(p)
+#define STBTT_malloc(x, u)                  ((void)(u), mem_alloc(x, LF_MEM_FONTS))
+#define STBTT_free(x, u)                    ((void)(u), mem_free(x))
+#define STBIR_MALLOC(size, user_data)       ((void)(user_data), mem_alloc(size, LF_MEM_TEXTURE_STAGING))
+#define STBIR_FREE(ptr, user_data)          ((void)(user_data), mem_free(ptr))
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #define STB_TRUETYPE_IMPLEMENTATION
@@ -13,7 +26,6 @@
 
 #include <libclipboard.h>
 
-#include <locale.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -21,13 +33,33 @@
 #include <stdarg.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
 #include <wchar.h>
-#include <wctype.h>
+
+// The software backend shades spans with SSE (and AVX2 if the CPU supports it) 
+// on x86 and works on the tiles with a pthread pool
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(LF_SW_NO_SIMD)
+#include <immintrin.h>
+#define LF_SW_X86
+#if defined(__GNUC__) || defined(__clang__)
+#define LF_SW_AVX2
+#endif
+#endif
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#define LF_SW_THREADS
+#endif
 
 #ifdef _WIN32
 #define HOMEDIR "USERPROFILE"
+#include <direct.h>
 #else
 #define HOMEDIR (char*)"HOME"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #endif
 
 #ifdef LF_GLFW 
@@ -82,13 +114,56 @@
 #define SCROLL_CALLBACK_t void*
 #define CURSOR_CALLBACK_t void*
 #endif
-#define MAX_RENDER_BATCH 10000
-#define MAX_TEX_COUNT_BATCH 32
+// Defaults of LfConfig
+#define MAX_RENDER_BATCH 65536
+// Texture units for standalone textures (fonts, big images), the unit after the 
+// last slot is used by the image texture array
+#define MAX_TEX_COUNT_BATCH LF_MAX_TEX_SLOTS
+#define LF_FONT_ATLAS_SIZE 1024
+#define LF_FRAME_ARENA_SIZE (64 * 1024)
+#define LF_MEM_HEADER_SIZE 16
+#define LF_TEXT_CACHE_SIZE (2 * 1024 * 1024)
+#define LF_TEXT_CACHE_NONE UINT32_MAX
+#define LF_TEXT_CACHE_ADMIT_SLOTS 256
+#define LF_TEXT_VIEW_INDEX_STRIDE 64
+#define LF_TEXT_VIEW_MAX_LINE 1024 // Bytes of a line that are laid out by the text view
+#define LF_GLYPH_ATLAS_PADDING 1
+#define LF_GLYPH_CACHE_VERSION 1
+// Distance fields reach LF_SDF_PADDING px beyond the outline, which lies at LF_SDF_ONEDGE
+#define LF_SDF_PADDING 4
+#define LF_SDF_ONEDGE 128
 #define MAX_KEY_CALLBACKS 4
 #define MAX_MOUSE_BTTUON_CALLBACKS 4
 #define MAX_SCROLL_CALLBACKS 4
 #define MAX_CURSOR_POS_CALLBACKS 4
 
+// Number of regions the persistently mapped vertex buffer is split into when 
+// vertex streaming is enabled (-DLF_VERTEX_STREAMING)
+#define LF_STREAM_REGIONS 3
+
+// Size of the hash table that maps texture ids to texture slots of the current draw command
+// (power of two, at least twice MAX_TEX_COUNT_BATCH)
+#define LF_TEX_SLOT_TABLE_SIZE 64
+
+// Linear filtered images that fit into a LF_TEX_ARRAY_LAYER_SIZE^2 layer are stored in 
+// GL_TEXTURE_2D_ARRAYs so they don't occupy texture slots. There is one array per power of two 
+// layer size from LF_TEX_ARRAY_MIN_SIZE up, an image goes into the smallest layers it fits into.
+#define LF_TEX_ARRAY_LAYER_SIZE 256
+#define LF_TEX_ARRAY_MIN_SIZE 32
+#define LF_TEX_ARRAY_CLASSES 4
+#define LF_TEX_ARRAY_INIT_LAYERS 4
+// The layer index handed to the renderer holds the size class in the bits above this shift
+#define LF_TEX_ARRAY_CLASS_SHIFT 13
+
+// How many runs of other pipelines an instance may be moved back over when the frame 
+// is grouped by pipeline & how many instances of those runs are tested for overlap
+#define LF_BATCH_LOOKBACK 16
+#define LF_BATCH_OVERLAP_TESTS 64
+
+// Size of the tiles the software backend bins instances into
+#define LF_SW_TILE_SIZE 64
+
+
 #define DJB2_INIT 5381
 
 // -- Struct Defines ---
@@ -96,19 +171,6 @@ typedef struct {
   uint32_t id;
 } LfShader;
 
-typedef struct {
-  vec2 pos; // 8 Bytes
-  vec4 border_color; // 16 Bytes
-  float border_width; // 4 Bytes 
-  vec4 color; // 16 Bytes
-  vec2 texcoord; // 8 Bytes
-  float tex_index; // 4 Bytes
-  vec2 scale; // 8 Bytes
-  vec2 pos_px; // 8 Bytes
-  float corner_radius; // 4 Bytes
-  vec2 min_coord, max_coord; // 16 Bytes
-} Vertex; // 88 Bytes per vertex
-
 typedef struct {
   bool keys[MAX_KEYS];
   bool keys_changed[MAX_KEYS];
@@ -134,24 +196,155 @@ typedef struct {
   LfKeyboard keyboard;
   LfMouse mouse;
 
-  // List of callbacks (user defined)
-  KEY_CALLBACK_t key_cbs[MAX_KEY_CALLBACKS];
-  MOUSE_BUTTON_CALLBACK_t mouse_button_cbs[MAX_MOUSE_BTTUON_CALLBACKS];
-  SCROLL_CALLBACK_t scroll_cbs[MAX_SCROLL_CALLBACKS];
-  CURSOR_CALLBACK_t cursor_pos_cbs[MAX_CURSOR_POS_CALLBACKS];
+  // List of callbacks (user defined, sized by LfConfig)
+  KEY_CALLBACK_t* key_cbs;
+  MOUSE_BUTTON_CALLBACK_t* mouse_button_cbs;
+  SCROLL_CALLBACK_t* scroll_cbs;
+  CURSOR_CALLBACK_t* cursor_pos_cbs;
 
   uint32_t key_cb_count, mouse_button_cb_count, scroll_cb_count, cursor_pos_cb_count;
 } InputState;
 
-// State of the batch renderer
 typedef struct {
-  LfShader shader;
-  uint32_t vao, vbo, ibo;
-  uint32_t vert_count;
-  Vertex* verts;
-  vec4s vert_pos[4];
-  LfTexture textures[MAX_TEX_COUNT_BATCH];
-  uint32_t tex_index, tex_count,index_count;
+  uint32_t id, epoch;
+  uint32_t slot;
+} TexSlot;
+
+typedef struct {
+  uint32_t id; // 0 = empty
+  uint16_t layer, width, height; // Layer with the size class in the bits above LF_TEX_ARRAY_CLASS_SHIFT
+} TexLayer;
+
+// Texture array of one layer size, created when the first image of the size is added
+typedef struct {
+  uint32_t id, size;
+  uint32_t layers, next_layer;
+  uint16_t* free_layers;
+  uint32_t free_count;
+} TexArray;
+
+// Run of instances that are drawn with the same pipeline
+typedef struct {
+  LfPipeline pipeline;
+  float min[2], max[2]; // Bounds of all instances in the run
+  uint32_t count, offset;
+  uint32_t last; // Last instance of the run (the others are linked through RenderState.batch_links)
+} PipelineBatch;
+
+// State of the OpenGL backend
+typedef struct {
+  LfShader shaders[LF_PIPELINE_COUNT];
+  uint32_t vao, vbo, vbo_cap;
+
+  // Clip table of the frame, read in the vertex shader through a buffer texture
+  uint32_t clip_buffer, clip_texture, clip_cap;
+
+  // Image texture arrays (texture id -> layer lookup is an open addressing hash table)
+  TexArray tex_arrays[LF_TEX_ARRAY_CLASSES];
+  TexLayer* tex_layers;
+  uint32_t tex_layer_cap, tex_layer_count;
+
+  // Persistently mapped instance streaming (lf_end() writes the instances of a frame 
+  // straight into the next of the mapped regions)
+  bool streaming;
+  LfDrawInstance* stream_base;
+  GLsync stream_fences[LF_STREAM_REGIONS];
+  uint32_t stream_region, stream_cap; // Region of the current frame & instances per region
+} GLBackendState;
+
+typedef struct {
+  uint32_t width, height;
+  uint8_t* pixels; // RGBA8, NULL = deleted
+  bool clamp, nearest;
+} SwTexture;
+
+typedef enum {
+  SW_SHADE_FLAT = 0, 
+  SW_SHADE_BORDER, 
+  SW_SHADE_ROUNDED
+} SwShadeMode;
+
+// Everything the span kernels need to shade one instance
+typedef struct {
+  int32_t x0, y0, x1, y1; // Covered pixels after clipping (max exclusive)
+  float cx, cy, hx, hy; // Center & half size in px
+  float radius, border_width;
+  float color[4], border_color[4];
+  float u0, du, v0, dv; // Texture coordinate at pixel center x is u0 + du * x
+  const SwTexture* tex;
+  float sdf_edge; // Half width of the edge of distance field glyphs in texel values, 0 for other instances
+  SwShadeMode mode;
+  bool hollow; // Transparent fill, only the border needs to be shaded
+} SwPrim;
+
+typedef struct {
+  uint32_t* prims;
+  uint32_t count, cap;
+} SwBin;
+
+typedef void (*SwSpanKernel)(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst);
+
+// State of the software backend
+typedef struct {
+  uint8_t* pixels; // RGBA8, top to bottom
+  uint32_t width, height;
+  LfColor clear_color;
+
+  SwTexture* textures;
+  uint32_t texture_count, texture_cap;
+  uint32_t* free_textures;
+  uint32_t free_texture_count;
+
+  SwPrim* prims;
+  uint32_t prim_cap;
+  SwBin* bins;
+  uint32_t tiles_x, tiles_y, next_tile;
+
+  SwSpanKernel span;
+
+#ifdef LF_SW_THREADS
+  pthread_t* threads;
+  uint32_t thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_cond, done_cond;
+  uint32_t generation, busy;
+  bool quit;
+#endif
+} SoftwareBackendState;
+
+// State of the renderer, the frame is recorded into a draw list which 
+// is submitted to the backend in lf_end()
+typedef struct {
+  LfRenderBackend backend;
+  LfDrawList list;
+
+  // Texture id -> slot lookup of the current draw command (entries of older commands are 
+  // invalidated by bumping the epoch)
+  TexSlot tex_slots[LF_TEX_SLOT_TABLE_SIZE];
+  uint32_t cmd_epoch;
+
+  // Scratch buffers for grouping the frame by pipeline
+  LfDrawInstance* batch_instances;
+  uint32_t batch_instance_cap;
+  uint32_t* batch_of, *batch_links;
+  uint32_t batch_of_cap;
+  LfDrawCmd* batch_cmds;
+  uint32_t batch_cmd_cap;
+  PipelineBatch* batches;
+  uint32_t batch_cap;
+  // Recording buffer of the draw list while its instances point into storage of the backend
+  LfDrawInstance* recorded_instances;
+
+  GLBackendState gl;
+  SoftwareBackendState sw;
+
+  // Statistics of the frame that is being recorded & of the last completed frame
+  LfFrameStats stats, frame_stats;
+  double frame_start;
+
+  // Clipping area (as set in LfState) of the entry in list.clips new instances reference
+  vec2s clip_start, clip_end;
+  uint16_t clip_index;
 } RenderState;
 
 typedef struct {
@@ -159,8 +352,196 @@ typedef struct {
   uint32_t count, cap;
 } PropsStack;
 
+typedef struct {
+  vec2s start, end; // -1 = not clipped
+} ClipRect;
+
+// Line of a laid out text, start & end are byte offsets into the string (end excludes the line break)
+typedef struct {
+  uint32_t start, end;
+  uint32_t first_index; // Code point index of the first character
+  uint32_t first_glyph; // Index of the first laid out glyph of the line
+  float width;
+} TextLine;
+
+// Line table computed by text_layout() in one pass, used for measuring & emitting glyphs
+typedef struct {
+  TextLine* lines;
+  uint32_t line_count, line_cap;
+  uint32_t glyph_count; // Glyphs that are laid out (excluding line breaks & missing glyphs)
+  float width;
+  bool mono; // Laid out by column (see text_layout_mono()), every byte is one character
+} TextLayout;
+
+// Glyph quad of a cached layout relative to the text origin, rounded to whole pixels once translated
+typedef struct {
+  float x, y;
+  LfGlyph* glyph;
+} TextCacheGlyph;
+
+// Glyph rasterized on a shelf of the atlas
+typedef struct {
+  LfGlyph* glyph;
+  uint32_t font_id;
+} AtlasSlot;
+
+// Row of glyphs of similar height, shelves are evicted as a whole
+typedef struct {
+  uint32_t y, height, x;
+  uint64_t last_used; // Frame the shelf was last drawn from
+  AtlasSlot* slots;
+  uint32_t slot_count, slot_cap;
+} AtlasShelf;
+
+// Glyph atlas shared by all fonts, glyphs are shelf packed on first use & uploaded at flush time
+typedef struct {
+  LfTexture texture;
+  uint8_t* pixels; // 8 bit coverage
+  uint32_t width, height;
+
+  AtlasShelf* shelves;
+  uint32_t shelf_count, shelf_cap;
+  uint32_t next_y; // Top of the space without shelves
+
+  // Rows that changed since the last upload, empty if dirty_y0 >= dirty_y1
+  uint32_t dirty_y0, dirty_y1;
+
+  uint64_t frame;
+  uint64_t generation; // Incremented by every eviction, texture coordinates of older generations may be stale
+  bool full; // Set when a glyph didn't fit, the atlas is cleared at the next frame
+  uint32_t font_count; // Font ids handed out
+} GlyphAtlas;
+
+// File of the on-disk glyph cache: header, records sorted by code point & the coverage of the glyphs
+typedef struct {
+  char magic[4]; // "LFGC"
+  uint32_t version;
+  uint64_t font_hash;
+  uint32_t font_size, record_count;
+} GlyphCacheHeader;
+
+typedef struct {
+  uint32_t codepoint;
+  int16_t xoff, yoff;
+  uint16_t width, height;
+  float advance;
+  uint32_t present;
+  uint32_t offset; // Of the coverage (width * height bytes) from the start of the file
+} GlyphCacheRecord;
+
+// Font file that is loaded once & shared by all sizes of the face
+typedef struct {
+  char* path; // NULL for faces in caller memory
+  const uint8_t* data;
+  size_t size;
+  bool mapped; // Unmapped on release, data read into memory is freed & caller memory is left alone
+  bool owned;
+  uint64_t hash; // Of the size & table directory, keys the on-disk glyph cache
+  stbtt_fontinfo info;
+  uint32_t refs;
+} FontFace;
+
+// Rasterized glyphs of one font file at one size, kept between runs
+typedef struct {
+  uint64_t font_hash;
+  uint32_t font_size; // Size the glyphs are rasterized at
+  bool sdf;
+  uint8_t* data; // Mapped file, NULL if there is none yet
+  size_t size;
+  const GlyphCacheRecord* records;
+  uint32_t record_count;
+  bool dirty; // Glyphs were loaded that are not in the file
+} GlyphCache;
+
+// Instances of a row of a LfCharGrid, relative to the grid & kept until the cells of the row change
+typedef struct {
+  uint32_t instance_count, glyph_count;
+  uint64_t generation; // Atlas generation the texture coordinates are from
+  bool built;
+} CharGridRow;
+
+typedef struct {
+  uint32_t cols, rows;
+  uint32_t font_id, font_size;
+  LfCharCell* cells; // Cells the rows were built from
+  CharGridRow* row_data;
+  LfDrawInstance* instances; // 2 * cols per row, the backgrounds of a row come before its glyphs
+  LfGlyph** glyphs; // Glyphs of every row, cols per row
+} CharGridCache;
+
+// Layout of a string kept across frames, keyed by the string, the font & the wrap width
+typedef struct {
+  uint64_t hash;
+  uint32_t font_id, font_size; // Views of SDF fonts share the id
+  float wrap_width;
+  uint32_t len;
+
+  // The string copy, lines & glyphs share one allocation
+  char* str;
+  TextLine* lines;
+  TextCacheGlyph* glyphs; // NULL for long texts that only keep their lines
+  uint32_t line_count, glyph_count;
+  float width, height, end_x, end_y; // end_x & end_y relative to the origin
+  bool mono;
+  size_t bytes;
+
+  // Caret positions, built on the first hit test (see text_carets())
+  float* carets;
+  uint32_t* caret_starts;
+
+  uint64_t frame; // Last frame the entry was used in, entries are not evicted during that frame
+  uint32_t bucket_next, lru_prev, lru_next;
+} TextCacheEntry;
+
+typedef struct {
+  TextCacheEntry* entries;
+  uint32_t entry_count, entry_cap, free_head;
+
+  // Chained hash buckets of entry indices
+  uint32_t* buckets;
+  uint32_t bucket_count;
+
+  // Most recently used entry at the head
+  uint32_t lru_head, lru_tail;
+  size_t bytes, capacity;
+
+  // Hashes of recent misses, a layout is only cached once it is seen a second time so that 
+  // text that changes every frame does not churn the cache
+  uint64_t admit[LF_TEXT_CACHE_ADMIT_SLOTS];
+  uint64_t frame;
+} TextCache;
+
+// Layout returned by lf_text_layout(), points into the frame arena or a text cache entry
+struct LfTextLayout {
+  const TextLine* lines;
+  uint32_t line_count;
+  // Pen x before every code point of a line & at its end, line after line
+  const float* carets;
+  const uint32_t* caret_starts; // First caret of every line (line_count + 1 entries)
+  float line_height;
+  float advance; // Width of every character of monospaced text, there are no carets then
+};
+
+// Prefix of every heap allocation, keeps the pointers handed out 16 byte aligned
+typedef struct {
+  size_t size;
+  uint32_t category;
+} MemHeader;
+
+// Scratch memory of one frame, released all at once in lf_begin()
+typedef struct {
+  uint8_t* base;
+  size_t size, used;
+
+  // Allocations that did not fit into base, base is grown to fit them on the next reset
+  void** overflow;
+  uint32_t overflow_count, overflow_cap;
+  size_t overflow_bytes;
+} FrameArena;
+
 typedef struct {
   bool init;
+  LfConfig config;
 
   // Window
   uint32_t dsp_w, dsp_h;
@@ -192,6 +573,18 @@ typedef struct {
 
   vec2s cull_start, cull_end;
 
+  FrameArena arena;
+  TextCache text_cache;
+  GlyphAtlas atlas;
+
+  // Loaded font files
+  FontFace** faces;
+  uint32_t face_count, face_cap;
+
+  // Clipping areas saved by lf_push_clip_rect() & lf_div_begin()
+  ClipRect* clip_stack;
+  uint32_t clip_stack_count, clip_stack_cap;
+
   LfTexture tex_arrow_down, tex_tick;
 
   bool text_wrap, line_overflow, div_hoverable, input_grabbed;
@@ -203,8 +596,6 @@ typedef struct {
 
   LfDiv selected_div, selected_div_tmp, scrollbar_div, grabbed_div;
 
-  uint32_t drawcalls;
-
   bool entered_div;
 
   bool div_velocity_accelerating;
@@ -226,14 +617,94 @@ typedef enum {
 // Static object to retrieve state data during runtime
 static LfState state;
 
+static void*                    default_alloc(void* user_data, size_t size);
+static void*                    default_realloc(void* user_data, void* ptr, size_t old_size, size_t new_size);
+static void                     default_free(void* user_data, void* ptr, size_t size);
+
+// Outside of the state so that it can be set before lf_init_ex() and outlives lf_terminate()
+static LfAllocator allocator = {.alloc = default_alloc, .realloc = default_realloc, .free = default_free};
+static size_t mem_usage[LF_MEM_CATEGORY_COUNT];
+
 // --- Renderer ---
 static uint32_t                 shader_create(GLenum type, const char* src);
 static LfShader                 shader_prg_create(const char* vert_src, const char* frag_src);
 static void                     shader_set_mat(LfShader prg, const char* name, mat4 mat); 
 static void                     set_projection_matrix();
-static void                     renderer_init();
 static void                     renderer_flush();
 static void                     renderer_begin();
+static void                     renderer_next_cmd();
+static void                     renderer_batch_pipelines();
+static void                     renderer_push_clip(vec2s start, vec2s end);
+static void                     renderer_instance_bounds(const LfDrawInstance* inst, float* min, float* max);
+static bool                     renderer_batch_overlaps(const PipelineBatch* batch, const float* min, const float* max, uint32_t* tests);
+static void                     renderer_add_instance(vec2s pos, vec2s size, vec4s texcoords, LfColor color, 
+                                                      LfColor border_color, float border_width, float corner_radius, uint16_t tex_index,
+                                                      LfPipeline pipeline);
+static void                     renderer_fill_instance(LfDrawInstance* inst, vec2s pos, vec2s size, vec4s texcoords, LfColor color, 
+                                                       LfColor border_color, float border_width, float corner_radius, uint16_t tex_index,
+                                                       LfPipeline pipeline);
+static void                     renderer_add_instances(const LfDrawInstance* instances, uint32_t count, vec2s offset, uint16_t tex_index);
+static uint16_t                 renderer_tex_slot(LfTexture tex);
+static void                     renderer_create_texture(LfTexture* tex, const unsigned char* data, int32_t channels, LfTextureFiltering filter, bool clamp);
+
+static bool                     gl_backend_init(void* user_data, uint32_t display_width, uint32_t display_height);
+static void                     gl_backend_terminate(void* user_data);
+static void                     gl_backend_resize(void* user_data, uint32_t display_width, uint32_t display_height);
+static void                     gl_backend_render(void* user_data, const LfDrawList* list);
+static void                     gl_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                                                          LfTextureFiltering filter, bool clamp);
+static void                     gl_backend_delete_texture(void* user_data, LfTexture* tex);
+static void                     gl_backend_update_texture(void* user_data, LfTexture* tex, uint32_t x, uint32_t y, 
+                                                          uint32_t width, uint32_t height, const unsigned char* data, int32_t channels);
+static bool                     gl_backend_texture_layer(void* user_data, uint32_t tex_id, uint16_t* layer, vec2s* uv_max);
+static LfDrawInstance*          gl_backend_instance_storage(void* user_data, uint32_t count);
+static void                     gl_backend_instance_layout();
+static void                     gl_backend_create_vbo();
+static bool                     gl_backend_create_stream(uint32_t cap);
+
+static bool                     null_backend_init(void* user_data, uint32_t display_width, uint32_t display_height);
+static void                     null_backend_render(void* user_data, const LfDrawList* list);
+static void                     null_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                                                            LfTextureFiltering filter, bool clamp);
+
+static bool                     sw_backend_init(void* user_data, uint32_t display_width, uint32_t display_height);
+static void                     sw_backend_terminate(void* user_data);
+static void                     sw_backend_resize(void* user_data, uint32_t display_width, uint32_t display_height);
+static void                     sw_backend_render(void* user_data, const LfDrawList* list);
+static void                     sw_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                                                          LfTextureFiltering filter, bool clamp);
+static void                     sw_backend_delete_texture(void* user_data, LfTexture* tex);
+static void                     sw_backend_update_texture(void* user_data, LfTexture* tex, uint32_t x, uint32_t y, 
+                                                          uint32_t width, uint32_t height, const unsigned char* data, int32_t channels);
+static void                     sw_resize_framebuffer(uint32_t width, uint32_t height);
+static void                     sw_render_tiles();
+static void                     sw_render_tile(uint32_t tile);
+static void                     sw_sample_span(const SwPrim* p, float py, int32_t x, int32_t n, float* tex);
+static void                     sw_sdf_span(const SwPrim* p, int32_t n, float* tex);
+static float                    sw_rounded_box_sdf(float ax, float ay, float hx, float hy, float radius);
+static void                     sw_span_scalar(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst);
+#ifdef LF_SW_X86
+static void                     sw_span_sse(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst);
+#endif
+#ifdef LF_SW_AVX2
+static void                     sw_span_avx2(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst);
+#endif
+#ifdef LF_SW_THREADS
+static void*                    sw_worker(void* arg);
+#endif
+
+static uint32_t                 png_crc(uint32_t crc, const uint8_t* buf, size_t size);
+static void                     png_write_chunk(FILE* file, const char* type, const uint8_t* data, uint32_t size);
+
+static void                     init_state(const LfConfig* config);
+
+static bool                     tex_array_add(uint32_t id, int32_t width, int32_t height, int32_t channels, const unsigned char* data, LfTextureFiltering filter);
+static void                     tex_array_upload(const TexArray* array, uint32_t layer, uint32_t width, uint32_t height, 
+                                                 int32_t channels, const unsigned char* data);
+static void                     tex_array_remove(uint32_t id);
+static TexLayer*                tex_array_find(uint32_t id);
+static bool                     tex_array_grow(TexArray* array);
+static void                     tex_layers_insert(TexLayer entry);
 
 static LfTextProps              text_render_simple(vec2s pos, const char* text, LfFont font, LfColor font_color, bool no_render);
 static LfTextProps              text_render_simple_wide(vec2s pos, const wchar_t* text, LfFont font, LfColor font_color, bool no_render);
@@ -244,11 +715,18 @@ static LfClickableItemState     button(const char* file, int32_t line, vec2s pos
 static LfClickableItemState     div_container(vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width, bool click_color, bool hover_color);
 static void                     next_line_on_overflow(vec2s size, float xoffset);
 static bool                     item_should_cull(LfAABB item);
+static double                   get_time();
 static void                     draw_scrollbar_on(LfDiv* div);
 
 static void                     input_field(LfInputField* input, InputFieldType type, const char* file, int32_t line);
 
-LfFont                          load_font(const char* filepath, uint32_t pixelsize, uint32_t tex_width, uint32_t tex_height, uint32_t line_gap_add);
+LfFont                          load_font(const char* filepath, uint32_t pixelsize, uint32_t tex_width, uint32_t tex_height, uint32_t line_gap_add, bool sdf);
+static LfFont                   font_create(FontFace* face, uint32_t pixelsize, uint32_t line_gap_add, bool sdf);
+static FontFace*                font_face_open(const char* filepath);
+static FontFace*                font_face_from_memory(const void* data, size_t size);
+static FontFace*                font_face_add(FontFace* face);
+static void                     font_face_unload(FontFace* face);
+static void                     font_face_release(FontFace* face);
 static LfFont                   get_current_font(); 
 
 static LfClickableItemState     button_element_loc(void* text, const char* file, int32_t line, bool wide);
@@ -259,6 +737,40 @@ static int32_t                  menu_item_list_item_loc(void** items, uint32_t i
 
 // --- Utility ---
 static int32_t                  get_max_char_height_font(LfFont font);
+static TextLayout               text_layout(const char* str, const LfFont* font, float max_width, int32_t end_index);
+static bool                     text_layout_mono(const char* str, const LfFont* font, float max_width, int32_t end_index, 
+                                                 TextLayout* layout);
+static LfTextProps              text_layout_emit(const TextLayout* layout, vec2s pos, const char* str, const LfFont* font, LfColor color, 
+                                                 vec2s stop_point, bool no_render, bool render_solid, int32_t start_index);
+static void                     text_visible_lines(float y, const LfFont* font, uint32_t line_count, uint32_t* first, uint32_t* last);
+static void                     text_view_index(LfTextView* view);
+static CharGridCache*           char_grid_cache(LfCharGrid* grid, const LfFont* font);
+static bool                     char_grid_build_row(CharGridCache* cache, uint32_t row, const LfFont* font, float cell_width);
+static void                     text_cache_place_glyphs(TextCacheEntry* entry, const LfFont* font);
+static TextCacheEntry*          text_cache_get(const char* str, const LfFont* font, float wrap_width);
+static LfTextProps              text_cache_emit(const TextCacheEntry* entry, vec2s pos, const LfFont* font, LfColor color, bool no_render);
+static void                     text_cache_remove(uint32_t index);
+static void                     text_cache_purge_font(uint32_t font_id);
+static void                     text_carets(const TextLine* lines, uint32_t line_count, const char* str, const LfFont* font, 
+                                            float* carets, uint32_t* caret_starts);
+static void                     font_set_metrics(LfFont* font);
+static LfGlyph*                 font_glyph(const LfFont* font, uint32_t cp);
+static LfGlyph*                 font_load_glyph(const LfFont* font, uint32_t cp);
+static void                     glyph_atlas_evict_shelf(AtlasShelf* shelf);
+static int32_t                  glyph_atlas_alloc_shelf(uint32_t w, uint32_t h);
+static void                     glyph_atlas_init();
+static void                     glyph_atlas_free();
+static void                     glyph_atlas_clear();
+static bool                     glyph_atlas_ensure(const LfFont* font, LfGlyph* glyph);
+static void                     glyph_atlas_upload();
+static void                     glyph_atlas_purge_font(uint32_t font_id);
+static void                     glyph_rasterize(const LfFont* font, const LfGlyph* glyph, uint8_t* dst, uint32_t stride);
+static bool                     glyph_cache_path(char* path, size_t size, const GlyphCache* cache);
+static GlyphCache*              glyph_cache_open(uint64_t font_hash, uint32_t font_size, bool sdf);
+static const GlyphCacheRecord*  glyph_cache_find(const GlyphCache* cache, uint32_t cp);
+static void                     glyph_cache_save(const LfFont* font);
+static void                     glyph_cache_close(LfFont* font);
+static void                     text_cache_free();
 
 static void                     remove_i_str(char *str, int32_t index);
 static void                     remove_substr_str(char *str, int start_index, int end_index);
@@ -288,6 +800,14 @@ static void                     props_stack_push(PropsStack* stack, LfUIElementP
 static LfUIElementProps         props_stack_pop(PropsStack* stack); 
 static LfUIElementProps         props_stack_peak(PropsStack* stack); 
 static bool                     props_stack_empty(PropsStack* stack);
+static void                     clip_stack_push();
+static void                     clip_stack_pop();
+
+static void*                    mem_calloc(size_t count, size_t size, LfMemCategory category);
+static void*                    arena_alloc(size_t size);
+static void                     arena_reset();
+static void                     arena_free();
+static char*                    arena_vsprintf(const char* fmt, va_list args);
 
 static LfUIElementProps         get_props_for(LfUIElementProps props);
 
@@ -365,161 +885,549 @@ void set_projection_matrix() {
   orthoMatrix[3][0] = -(right + left) / (right - left);
   orthoMatrix[3][1] = -(top + bottom) / (top - bottom);
 
-  shader_set_mat(state.render.shader, "u_proj", orthoMatrix);
+  for(uint32_t i = 0; i < LF_PIPELINE_COUNT; i++) {
+    glUseProgram(state.render.gl.shaders[i].id);
+    shader_set_mat(state.render.gl.shaders[i], "u_proj", orthoMatrix);
+  }
 }
 
-void renderer_init() {
-  // OpenGL Setup 
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void* mem_alloc(size_t size, LfMemCategory category) {
+  // Every heap allocation of leif goes through here so steady state frames can be checked for allocations
+  state.render.stats.heap_allocs++;
+  MemHeader* header = (MemHeader*)allocator.alloc(allocator.user_data, LF_MEM_HEADER_SIZE + size);
+  if(!header) return NULL;
+  header->size = size;
+  header->category = category;
+  mem_usage[category] += size;
+  return (uint8_t*)header + LF_MEM_HEADER_SIZE;
+}
+
+void* mem_calloc(size_t count, size_t size, LfMemCategory category) {
+  void* ptr = mem_alloc(count * size, category);
+  if(ptr) 
+    memset(ptr, 0, count * size);
+  return ptr;
+}
 
-  state.render.vert_count = 0;
-  state.render.verts = (Vertex*)malloc(sizeof(Vertex) * MAX_RENDER_BATCH * 4);
+void* mem_realloc(void* ptr, size_t size, LfMemCategory category) {
+  if(!ptr) return mem_alloc(size, category);
+  state.render.stats.heap_allocs++;
+  MemHeader* header = (MemHeader*)((uint8_t*)ptr - LF_MEM_HEADER_SIZE);
+  size_t old_size = header->size;
+  LfMemCategory old_category = header->category;
+  header = (MemHeader*)allocator.realloc(allocator.user_data, header, LF_MEM_HEADER_SIZE + old_size, LF_MEM_HEADER_SIZE + size);
+  if(!header) return NULL;
+  mem_usage[old_category] -= old_size;
+  mem_usage[old_category] += size;
+  header->size = size;
+  return (uint8_t*)header + LF_MEM_HEADER_SIZE;
+}
 
-  /* Creating vertex array & vertex buffer for the batch renderer */
-  glCreateVertexArrays(1, &state.render.vao);
-  glBindVertexArray(state.render.vao);
+void mem_free(void* ptr) {
+  if(!ptr) return;
+  MemHeader* header = (MemHeader*)((uint8_t*)ptr - LF_MEM_HEADER_SIZE);
+  mem_usage[header->category] -= header->size;
+  allocator.free(allocator.user_data, header, LF_MEM_HEADER_SIZE + header->size);
+}
 
-  glCreateBuffers(1, &state.render.vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, state.render.vbo);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * MAX_RENDER_BATCH * 4, NULL, 
-               GL_DYNAMIC_DRAW);
+void* default_alloc(void* user_data, size_t size) {
+  (void)user_data;
+  return malloc(size);
+}
+
+void* default_realloc(void* user_data, void* ptr, size_t old_size, size_t new_size) {
+  (void)user_data; (void)old_size;
+  return realloc(ptr, new_size);
+}
+
+void default_free(void* user_data, void* ptr, size_t size) {
+  (void)user_data; (void)size;
+  free(ptr);
+}
+
+void* arena_alloc(size_t size) {
+  FrameArena* arena = &state.arena;
+  size = (size + 15) & ~(size_t)15;
+  if(arena->used + size <= arena->size) {
+    void* ptr = arena->base + arena->used;
+    arena->used += size;
+    return ptr;
+  }
+
+  // Falling back to the heap until the next reset
+  if(arena->overflow_count >= arena->overflow_cap) {
+    arena->overflow_cap = arena->overflow_cap ? arena->overflow_cap * 2 : 16;
+    arena->overflow = (void**)mem_realloc(arena->overflow, sizeof(void*) * arena->overflow_cap, LF_MEM_FRAME_SCRATCH);
+  }
+  void* ptr = mem_alloc(size, LF_MEM_FRAME_SCRATCH);
+  arena->overflow[arena->overflow_count++] = ptr;
+  arena->overflow_bytes += size;
+  return ptr;
+}
+
+void arena_reset() {
+  FrameArena* arena = &state.arena;
+  if(arena->overflow_count) {
+    // Growing the arena so that the next frame fits into one block
+    size_t needed = arena->used + arena->overflow_bytes;
+    for(uint32_t i = 0; i < arena->overflow_count; i++) 
+      mem_free(arena->overflow[i]);
+    arena->overflow_count = 0;
+    arena->overflow_bytes = 0;
+
+    size_t size = arena->size ? arena->size : LF_FRAME_ARENA_SIZE;
+    while(size < needed) 
+      size *= 2;
+    arena->size = size;
+    mem_free(arena->base);
+    arena->base = (uint8_t*)mem_alloc(arena->size, LF_MEM_FRAME_SCRATCH);
+  }
+  arena->used = 0;
+}
+
+char* arena_vsprintf(const char* fmt, va_list args) {
+  va_list len_args;
+  va_copy(len_args, args);
+  int32_t len = vsnprintf(NULL, 0, fmt, len_args);
+  va_end(len_args);
+  if(len < 0) return NULL;
+
+  char* str = (char*)arena_alloc(len + 1);
+  vsnprintf(str, len + 1, fmt, args);
+  return str;
+}
+
+void arena_free() {
+  FrameArena* arena = &state.arena;
+  for(uint32_t i = 0; i < arena->overflow_count; i++) 
+    mem_free(arena->overflow[i]);
+  mem_free(arena->overflow);
+  mem_free(arena->base);
+  memset(arena, 0, sizeof(*arena));
+}
+
+void renderer_begin() {
+  LfDrawList* list = &state.render.list;
+  if(state.render.recorded_instances) {
+    list->instances = state.render.recorded_instances;
+    state.render.recorded_instances = NULL;
+  }
+  list->instance_count = 0;
+  list->cmd_count = 0;
+  list->texture_count = 0;
+  list->display_width = state.dsp_w;
+  list->display_height = state.dsp_h;
+  memset(list->pipeline_counts, 0, sizeof(list->pipeline_counts));
+  list->clip_count = 0;
+  renderer_push_clip((vec2s){-1, -1}, (vec2s){-1, -1});
+  renderer_next_cmd();
+}
+
+void renderer_next_cmd() {
+  LfDrawList* list = &state.render.list;
+  if(list->cmd_count >= list->cmd_cap) {
+    list->cmd_cap = list->cmd_cap ? list->cmd_cap * 2 : 16;
+    list->cmds = (LfDrawCmd*)mem_realloc(list->cmds, sizeof(LfDrawCmd) * list->cmd_cap, LF_MEM_BATCH);
+  }
+  list->cmds[list->cmd_count++] = (LfDrawCmd){
+    .first_instance = list->instance_count, 
+    .first_texture = list->texture_count, 
+  };
+  // Invalidating the texture slots of the previous command
+  state.render.cmd_epoch++;
+}
+
+void renderer_flush() {
+  renderer_batch_pipelines();
+  glyph_atlas_upload();
+
+  // Handing the recorded frame to the backend
+  if(state.render.backend.render)
+    state.render.backend.render(state.render.backend.user_data, &state.render.list);
+}
+
+void renderer_batch_pipelines() {
+  // Splitting every command into runs of one pipeline. An instance is moved back into an earlier 
+  // run of its pipeline if it doesn't overlap any of the runs in between, so painter's order is 
+  // kept while a frame only needs a few program switches.
+  RenderState* r = &state.render;
+  LfDrawList* list = &r->list;
+  // The grouped frame is written straight into storage of the backend if it hands any out
+  LfDrawInstance* out_instances = NULL;
+  if(r->backend.instance_storage && list->instance_count)
+    out_instances = r->backend.instance_storage(r->backend.user_data, list->instance_count);
+  if(!out_instances) {
+    if(list->instance_count > r->batch_instance_cap) {
+      r->batch_instance_cap = list->instance_cap;
+      r->batch_instances = (LfDrawInstance*)mem_realloc(r->batch_instances, sizeof(LfDrawInstance) * r->batch_instance_cap, LF_MEM_BATCH);
+    }
+    out_instances = r->batch_instances;
+  }
+  if(list->instance_count > r->batch_of_cap) {
+    r->batch_of_cap = list->instance_cap;
+    r->batch_of = (uint32_t*)mem_realloc(r->batch_of, sizeof(uint32_t) * r->batch_of_cap, LF_MEM_BATCH);
+    r->batch_links = (uint32_t*)mem_realloc(r->batch_links, sizeof(uint32_t) * r->batch_of_cap, LF_MEM_BATCH);
+  }
+
+  uint32_t cmd_count = 0;
+  for(uint32_t c = 0; c < list->cmd_count; c++) {
+    const LfDrawCmd* cmd = &list->cmds[c];
+    uint32_t batch_count = 0;
+    uint32_t end = cmd->first_instance + cmd->instance_count;
+
+    for(uint32_t i = cmd->first_instance; i < end; i++) {
+      const LfDrawInstance* inst = &list->instances[i];
+      float min[2], max[2];
+      renderer_instance_bounds(inst, min, max);
+
+      int32_t target = -1;
+      uint32_t tests = LF_BATCH_OVERLAP_TESTS;
+      for(int32_t j = (int32_t)batch_count - 1; j >= 0 && (int32_t)batch_count - j <= LF_BATCH_LOOKBACK; j--) {
+        const PipelineBatch* b = &r->batches[j];
+        if(b->pipeline == inst->flags) {
+          target = j;
+          break;
+        }
+        if(renderer_batch_overlaps(b, min, max, &tests)) break;
+      }
+
+      if(target == -1) {
+        if(batch_count >= r->batch_cap) {
+          r->batch_cap = r->batch_cap ? r->batch_cap * 2 : 64;
+          r->batches = (PipelineBatch*)mem_realloc(r->batches, sizeof(PipelineBatch) * r->batch_cap, LF_MEM_BATCH);
+        }
+        target = batch_count++;
+        r->batches[target] = (PipelineBatch){.pipeline = (LfPipeline)inst->flags, 
+          .min = {min[0], min[1]}, .max = {max[0], max[1]}, .last = UINT32_MAX};
+      } else {
+        PipelineBatch* b = &r->batches[target];
+        b->min[0] = fminf(b->min[0], min[0]);
+        b->min[1] = fminf(b->min[1], min[1]);
+        b->max[0] = fmaxf(b->max[0], max[0]);
+        b->max[1] = fmaxf(b->max[1], max[1]);
+      }
+      PipelineBatch* b = &r->batches[target];
+      b->count++;
+      r->batch_links[i] = b->last;
+      b->last = i;
+      r->batch_of[i] = target;
+    }
+
+    if(batch_count > 1) 
+      r->stats.flushes[LF_FLUSH_PIPELINE] += batch_count - 1;
+
+    // Emitting one command per run (the runs share the texture slots of the command)
+    if(cmd_count + batch_count > r->batch_cmd_cap) {
+      while(r->batch_cmd_cap < cmd_count + batch_count) 
+        r->batch_cmd_cap = r->batch_cmd_cap ? r->batch_cmd_cap * 2 : 16;
+      r->batch_cmds = (LfDrawCmd*)mem_realloc(r->batch_cmds, sizeof(LfDrawCmd) * r->batch_cmd_cap, LF_MEM_BATCH);
+    }
+    uint32_t offset = cmd->first_instance;
+    for(uint32_t j = 0; j < batch_count; j++) {
+      LfDrawCmd* out = &r->batch_cmds[cmd_count++];
+      *out = *cmd;
+      out->first_instance = offset;
+      out->instance_count = r->batches[j].count;
+      out->pipeline = r->batches[j].pipeline;
+      r->batches[j].offset = offset;
+      offset += r->batches[j].count;
+    }
+    for(uint32_t i = cmd->first_instance; i < end; i++) 
+      out_instances[r->batches[r->batch_of[i]].offset++] = list->instances[i];
+  }
+
+  // Swapping the grouped frame into the draw list, the recording buffer is put back 
+  // in lf_begin() if the frame lives in storage of the backend
+  if(out_instances == r->batch_instances) {
+    LfDrawInstance* instances = list->instances;
+    uint32_t instance_cap = list->instance_cap;
+    list->instances = r->batch_instances;
+    list->instance_cap = r->batch_instance_cap;
+    r->batch_instances = instances;
+    r->batch_instance_cap = instance_cap;
+  } else {
+    r->recorded_instances = list->instances;
+    list->instances = out_instances;
+  }
+
+  LfDrawCmd* cmds = list->cmds;
+  uint32_t cmd_cap = list->cmd_cap;
+  list->cmds = r->batch_cmds;
+  list->cmd_cap = r->batch_cmd_cap;
+  list->cmd_count = cmd_count;
+  r->batch_cmds = cmds;
+  r->batch_cmd_cap = cmd_cap;
+}
+
+void renderer_push_clip(vec2s start, vec2s end) {
+  RenderState* r = &state.render;
+  LfDrawList* list = &r->list;
+  r->clip_start = start;
+  r->clip_end = end;
+  if(list->clip_count > UINT16_MAX) {
+    LF_WARN("Too many clipping areas in one frame, keeping the last one.");
+    return;
+  }
+  if(list->clip_count >= list->clip_cap) {
+    list->clip_cap = list->clip_cap ? list->clip_cap * 2 : 64;
+    list->clips = (LfAABB*)mem_realloc(list->clips, sizeof(LfAABB) * list->clip_cap, LF_MEM_BATCH);
+  }
+  // Unclipped sides extend to the display, clipping areas are in whole pixels
+  float x0 = start.x == -1 ? 0.0f : truncf(start.x);
+  float y0 = start.y == -1 ? 0.0f : truncf(start.y);
+  float x1 = end.x == -1 ? (float)list->display_width : truncf(end.x);
+  float y1 = end.y == -1 ? (float)list->display_height : truncf(end.y);
+  list->clips[list->clip_count] = (LfAABB){.pos = (vec2s){x0, y0}, .size = (vec2s){x1 - x0, y1 - y0}};
+  r->clip_index = (uint16_t)list->clip_count++;
+}
+
+void renderer_instance_bounds(const LfDrawInstance* inst, float* min, float* max) {
+  // Rounded quads are grown by the smoothed edge of the SDF
+  float margin = inst->corner_radius ? 2.0f : 0.0f;
+  for(uint32_t i = 0; i < 2; i++) {
+    min[i] = fminf(inst->pos[i], inst->pos[i] + inst->size[i]) - margin;
+    max[i] = fmaxf(inst->pos[i], inst->pos[i] + inst->size[i]) + margin;
+  }
+}
+
+bool renderer_batch_overlaps(const PipelineBatch* batch, const float* min, const float* max, uint32_t* tests) {
+  if(!(min[0] < batch->max[0] && batch->min[0] < max[0] && min[1] < batch->max[1] && batch->min[1] < max[1])) 
+    return false;
+  // Testing the instances of the run one by one (most recent first) until the budget is used up
+  const LfDrawList* list = &state.render.list;
+  for(uint32_t i = batch->last; i != UINT32_MAX; i = state.render.batch_links[i]) {
+    if(!*tests) return true;
+    (*tests)--;
+    float inst_min[2], inst_max[2];
+    renderer_instance_bounds(&list->instances[i], inst_min, inst_max);
+    if(min[0] < inst_max[0] && inst_min[0] < max[0] && min[1] < inst_max[1] && inst_min[1] < max[1]) 
+      return true;
+  }
+  return false;
+}
+
+void renderer_add_instance(vec2s pos, vec2s size, vec4s texcoords, LfColor color, 
+                           LfColor border_color, float border_width, float corner_radius, uint16_t tex_index,
+                           LfPipeline pipeline) {
+  RenderState* r = &state.render;
+  LfDrawList* list = &r->list;
+
+  // Adding a new entry to the clip table when the clipping area changed
+  if(state.cull_start.x != r->clip_start.x || state.cull_start.y != r->clip_start.y || 
+    state.cull_end.x != r->clip_end.x || state.cull_end.y != r->clip_end.y) 
+    renderer_push_clip(state.cull_start, state.cull_end);
 
-  uint32_t* indices = (uint32_t*)malloc(sizeof(uint32_t) * MAX_RENDER_BATCH * 6);
+  // Instances that are clipped away entirely are never recorded
+  const LfAABB* clip = &list->clips[r->clip_index];
+  float margin = corner_radius != 0.0f ? 2.0f : 0.0f;
+  if(fmaxf(pos.x, pos.x + size.x) + margin <= clip->pos.x || fminf(pos.x, pos.x + size.x) - margin >= clip->pos.x + clip->size.x ||
+    fmaxf(pos.y, pos.y + size.y) + margin <= clip->pos.y || fminf(pos.y, pos.y + size.y) - margin >= clip->pos.y + clip->size.y) {
+    r->stats.culled++;
+    return;
+  }
+
+  if(list->instance_count >= list->instance_cap) {
+    list->instance_cap = list->instance_cap ? list->instance_cap * 2 : 1024;
+    list->instances = (LfDrawInstance*)mem_realloc(list->instances, sizeof(LfDrawInstance) * list->instance_cap, LF_MEM_BATCH);
+  }
+  LfDrawInstance* inst = &list->instances[list->instance_count++];
+  list->cmds[list->cmd_count - 1].instance_count++;
+  renderer_fill_instance(inst, pos, size, texcoords, color, border_color, border_width, corner_radius, tex_index, pipeline);
+  list->pipeline_counts[pipeline]++;
+  inst->clip_index = r->clip_index;
+}
 
-  uint32_t offset = 0;
-  for (uint32_t i = 0; i < MAX_RENDER_BATCH * 6; i += 6) {
-    indices[i + 0] = offset + 0;
-    indices[i + 1] = offset + 1;
-    indices[i + 2] = offset + 2;
+void renderer_fill_instance(LfDrawInstance* inst, vec2s pos, vec2s size, vec4s texcoords, LfColor color, 
+                            LfColor border_color, float border_width, float corner_radius, uint16_t tex_index,
+                            LfPipeline pipeline) {
+  inst->pos[0] = pos.x;
+  inst->pos[1] = pos.y;
+  inst->size[0] = size.x;
+  inst->size[1] = size.y;
 
-    indices[i + 3] = offset + 2;
-    indices[i + 4] = offset + 3;
-    indices[i + 5] = offset + 0;
-    offset += 4;
+  for(uint32_t i = 0; i < 4; i++) {
+    float t = texcoords.raw[i] < 0.0f ? 0.0f : (texcoords.raw[i] > 1.0f ? 1.0f : texcoords.raw[i]);
+    inst->texcoords[i] = (uint16_t)(t * 65535.0f + 0.5f);
   }
-  glCreateBuffers(1, &state.render.ibo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.render.ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, MAX_RENDER_BATCH * 6 * sizeof(uint32_t), indices, GL_STATIC_DRAW);
 
-  free(indices); 
-  // Setting the vertex layout
-  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
-  glEnableVertexAttribArray(0);
+  memcpy(inst->color, &color, sizeof(inst->color));
+  memcpy(inst->border_color, &border_color, sizeof(inst->border_color));
 
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t)offsetof(Vertex, border_color));
-  glEnableVertexAttribArray(1);
+  inst->tex_index = tex_index;
+  inst->corner_radius = (uint16_t)fminf(fmaxf(corner_radius, 0.0f) * LF_FIXED_POINT_SCALE, 65535.0f);
+  inst->border_width = (uint16_t)fminf(fmaxf(border_width, 0.0f) * LF_FIXED_POINT_SCALE, 65535.0f);
+  inst->flags = (uint16_t)pipeline;
+}
 
-  glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t)offsetof(Vertex, border_width));
-  glEnableVertexAttribArray(2);
+void renderer_add_instances(const LfDrawInstance* instances, uint32_t count, vec2s offset, uint16_t tex_index) {
+  // Appending prebuilt instances, textured ones are moved to the given texture slot
+  RenderState* r = &state.render;
+  LfDrawList* list = &r->list;
+  if(state.cull_start.x != r->clip_start.x || state.cull_start.y != r->clip_start.y || 
+    state.cull_end.x != r->clip_end.x || state.cull_end.y != r->clip_end.y) 
+    renderer_push_clip(state.cull_start, state.cull_end);
 
-  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t)offsetof(Vertex, color));
-  glEnableVertexAttribArray(3);
+  if(list->instance_count + count > list->instance_cap) {
+    while(list->instance_count + count > list->instance_cap) 
+      list->instance_cap = list->instance_cap ? list->instance_cap * 2 : 1024;
+    list->instances = (LfDrawInstance*)mem_realloc(list->instances, sizeof(LfDrawInstance) * list->instance_cap, LF_MEM_BATCH);
+  }
+  LfDrawInstance* dst = &list->instances[list->instance_count];
+  memcpy(dst, instances, sizeof(LfDrawInstance) * count);
+  for(uint32_t i = 0; i < count; i++) {
+    dst[i].pos[0] += offset.x;
+    dst[i].pos[1] += offset.y;
+    if(dst[i].tex_index != LF_NO_TEXTURE) 
+      dst[i].tex_index = tex_index;
+    dst[i].clip_index = r->clip_index;
+    list->pipeline_counts[dst[i].flags]++;
+  }
+  list->instance_count += count;
+  list->cmds[list->cmd_count - 1].instance_count += count;
+}
 
-  glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, texcoord));
-  glEnableVertexAttribArray(4);
+uint16_t renderer_tex_slot(LfTexture tex) {
+  LfDrawList* list = &state.render.list;
+  LfDrawCmd* cmd = &list->cmds[list->cmd_count - 1];
+  const uint32_t mask = LF_TEX_SLOT_TABLE_SIZE - 1;
+  uint32_t i = (tex.id * 2654435761u) & mask;
 
-  glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, tex_index));
-  glEnableVertexAttribArray(5);
+  // Texture is already used by the current command
+  while(state.render.tex_slots[i].epoch == state.render.cmd_epoch) {
+    if(state.render.tex_slots[i].id == tex.id) 
+      return (uint16_t)state.render.tex_slots[i].slot;
+    i = (i + 1) & mask;
+  }
 
-  glVertexAttribPointer(6, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, scale));
-  glEnableVertexAttribArray(6);
+  // Out of texture slots, starting a new command (invalidates the whole table)
+  if(cmd->texture_count >= state.config.tex_slots) {
+    state.render.stats.flushes[LF_FLUSH_TEXTURE_SLOTS]++;
+    renderer_next_cmd();
+    cmd = &list->cmds[list->cmd_count - 1];
+    i = (tex.id * 2654435761u) & mask;
+  }
+  if(list->texture_count >= list->texture_cap) {
+    list->texture_cap = list->texture_cap ? list->texture_cap * 2 : 64;
+    list->textures = (LfTexture*)mem_realloc(list->textures, sizeof(LfTexture) * list->texture_cap, LF_MEM_BATCH);
+  }
+  list->textures[list->texture_count++] = tex;
+  state.render.tex_slots[i] = (TexSlot){.id = tex.id, .epoch = state.render.cmd_epoch, .slot = cmd->texture_count};
+  return (uint16_t)cmd->texture_count++;
+}
 
-  glVertexAttribPointer(7, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, pos_px));
-  glEnableVertexAttribArray(7);
+void renderer_create_texture(LfTexture* tex, const unsigned char* data, int32_t channels, LfTextureFiltering filter, bool clamp) {
+  if(!state.render.backend.create_texture) {
+    LF_ERROR("Trying to create a texture without a render backend.");
+    return;
+  }
+  state.render.backend.create_texture(state.render.backend.user_data, tex, data, channels, filter, clamp);
+}
 
-  glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, corner_radius));
-  glEnableVertexAttribArray(8);
+bool gl_backend_init(void* user_data, uint32_t display_width, uint32_t display_height) {
+  (void)user_data; (void)display_width; (void)display_height;
+  if(!glCreateShader && !gladLoadGL()) {
+    LF_ERROR("Failed to load the OpenGL functions for the OpenGL backend.");
+    return false;
+  }
+  GLBackendState* gl = &state.render.gl;
 
-  glVertexAttribPointer(10, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, min_coord));
-  glEnableVertexAttribArray(10);
+  // OpenGL Setup 
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  glVertexAttribPointer(11, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(intptr_t*)offsetof(Vertex, max_coord));
-  glEnableVertexAttribArray(11);
+  /* Creating vertex array & instance buffer for the backend */
+  glCreateVertexArrays(1, &gl->vao);
+  glBindVertexArray(gl->vao);
 
-  // Creating the shader for the batch renderer
+#ifdef LF_VERTEX_STREAMING
+  // Persistent mapping requires OpenGL 4.4 (glBufferStorage)
+  gl->streaming = GLAD_GL_VERSION_4_4 && gl_backend_create_stream(state.config.batch_capacity);
+#endif
+  if(!gl->streaming) 
+    gl_backend_create_vbo();
+  gl_backend_instance_layout();
+
+  // Creating the clip table (one RGBA32F texel per LfAABB)
+  gl->clip_cap = 256;
+  glCreateBuffers(1, &gl->clip_buffer);
+  glNamedBufferData(gl->clip_buffer, sizeof(LfAABB) * gl->clip_cap, NULL, GL_DYNAMIC_DRAW);
+  glCreateTextures(GL_TEXTURE_BUFFER, 1, &gl->clip_texture);
+  glTextureBuffer(gl->clip_texture, GL_RGBA32F, gl->clip_buffer);
+
+  // Creating the shaders for the backend
   const char* vert_src =
     "#version 450 core\n"
     "layout (location = 0) in vec2 a_pos;\n"
-    "layout (location = 1) in vec4 a_border_color;\n"
-    "layout (location = 2) in float a_border_width;\n"
+    "layout (location = 1) in vec2 a_size;\n"
+    "layout (location = 2) in vec4 a_texcoords;\n"
     "layout (location = 3) in vec4 a_color;\n"
-    "layout (location = 4) in vec2 a_texcoord;\n"
-    "layout (location = 5) in float a_tex_index;\n"
-    "layout (location = 6) in vec2 a_scale;\n"
-    "layout (location = 7) in vec2 a_pos_px;\n"
-    "layout (location = 8) in float a_corner_radius;\n"
-    "layout (location = 10) in vec2 a_min_coord;\n"
-    "layout (location = 11) in vec2 a_max_coord;\n"
+    "layout (location = 4) in vec4 a_border_color;\n"
+    "layout (location = 5) in uvec2 a_tex_index_radius;\n"
+    "layout (location = 6) in uvec3 a_border_width_flags_clip;\n"
 
     "uniform mat4 u_proj;\n"
-    "out vec4 v_border_color;\n"
-    "out float v_border_width;\n"
-    "out vec4 v_color;\n"
+    "uniform samplerBuffer u_clips;\n"
+    "flat out vec4 v_border_color;\n"
+    "flat out float v_border_width;\n"
+    "flat out vec4 v_color;\n"
     "out vec2 v_texcoord;\n"
-    "out float v_tex_index;\n"
+    "flat out uint v_tex_index;\n"
     "flat out vec2 v_scale;\n"
     "flat out vec2 v_pos_px;\n"
-    "flat out float v_is_gradient;\n"
-    "out float v_corner_radius;\n"
-    "out vec2 v_min_coord;\n"
-    "out vec2 v_max_coord;\n"
+    "flat out float v_corner_radius;\n"
 
     "void main() {\n"
+    // Unit quad corner of this vertex (drawn as a 4 vertex triangle strip)
+    "vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    // Fixed point values are in 1/LF_FIXED_POINT_SCALE px
+    "v_corner_radius = float(a_tex_index_radius.y) / 16.0f;\n"
+    "v_border_width = float(a_border_width_flags_clip.x) / 16.0f;\n"
+    // Rounded quads are grown by the smoothed edge of the SDF (edge_softness * 2.0 in the fragment shader)
+    "float margin = (v_corner_radius != 0.0f) ? 2.0f : 0.0f;\n"
+    "vec2 quad_min = a_pos - margin;\n"
+    "vec2 quad_max = a_pos + a_size + margin;\n"
+    // Clipping the quad itself instead of discarding fragments (the clip table stores pos & size)
+    "vec4 clip = texelFetch(u_clips, int(a_border_width_flags_clip.z));\n"
+    "vec2 offset = min(max(mix(quad_min, quad_max, corner), clip.xy), clip.xy + clip.zw) - a_pos;\n"
+    "vec2 t = mix(corner, offset / a_size, notEqual(a_size, vec2(0.0f)));\n"
+    "v_texcoord = mix(a_texcoords.xy, a_texcoords.zw, t);\n"
+    "v_tex_index = a_tex_index_radius.x;\n"
     "v_color = a_color;\n"
-    "v_texcoord = a_texcoord;\n"
-    "v_tex_index = a_tex_index;\n"
     "v_border_color = a_border_color;\n"
-    "v_border_width = a_border_width;\n"
-    "v_scale = a_scale;\n"
-    "v_pos_px = a_pos_px;\n"
-    "v_corner_radius = a_corner_radius;\n"
-    "v_min_coord = a_min_coord;\n"
-    "v_max_coord = a_max_coord;\n"
-    "gl_Position = u_proj * vec4(a_pos.x, a_pos.y, 0.0f, 1.0);\n"
+    "v_scale = a_size;\n"
+    "v_pos_px = a_pos;\n"
+    "gl_Position = u_proj * vec4(a_pos + offset, 0.0f, 1.0);\n"
     "}\n";
 
-
-  const char* frag_src = "#version 450 core\n"
+  // One fragment shader source, every pipeline only compiles the path it needs
+  const char* frag_src = 
     "out vec4 o_color;\n"
-    "in vec4 v_color;\n"
-    "in float v_tex_index;\n"
-    "in vec4 v_border_color;\n"
-    "in float v_border_width;\n"
+    "flat in vec4 v_color;\n"
+    "flat in uint v_tex_index;\n"
+    "flat in vec4 v_border_color;\n"
+    "flat in float v_border_width;\n"
     "in vec2 v_texcoord;\n"
     "flat in vec2 v_scale;\n"
     "flat in vec2 v_pos_px;\n"
-    "in float v_corner_radius;\n"
-    "uniform sampler2D u_textures[32];\n"
+    "flat in float v_corner_radius;\n"
+    "#if defined(LF_GLYPH) || defined(LF_GLYPH_SDF) || defined(LF_IMAGE)\n"
+    "uniform sampler2D u_textures[LF_TEX_SLOTS];\n"
+    "#endif\n"
+    "#ifdef LF_IMAGE\n"
+    "uniform sampler2DArray u_tex_arrays[LF_TEX_ARRAY_CLASSES];\n"
+    "#endif\n"
+
+    "#if defined(LF_SHAPE) || defined(LF_IMAGE)\n"
     "uniform vec2 u_screen_size;\n"
-    "in vec2 v_min_coord;\n"
-    "in vec2 v_max_coord;\n"
-
     "float rounded_box_sdf(vec2 center_pos, vec2 size, float radius) {\n"
     "    return length(max(abs(center_pos)-size+radius,0.0))-radius;\n"
     "}\n"
 
-    "void main() {\n"
-    "     if(u_screen_size.y - gl_FragCoord.y < v_min_coord.y && v_min_coord.y != -1) {\n"
-    "         discard;\n"
-    "     }\n"
-    "     if(u_screen_size.y - gl_FragCoord.y > v_max_coord.y && v_max_coord.y != -1) {\n"
-    "         discard;\n"
-    "     }\n"
-    "     if ((gl_FragCoord.x < v_min_coord.x && v_min_coord.x != -1) || (gl_FragCoord.x > v_max_coord.x && v_max_coord.x != -1)) {\n"
-    "         discard;\n" 
-    "     }\n"
+    "vec4 shade_shape(vec4 opaque_color) {\n"
     "     vec2 size = v_scale;\n"
-    "     vec4 opaque_color, display_color;\n"
-    "     if(v_tex_index == -1) {\n"
-    "       opaque_color = v_color;\n"
-    "     } else {\n"
-    "       opaque_color = texture(u_textures[int(v_tex_index)], v_texcoord) * v_color;\n"
-    "     }\n"
+    "     vec2 location = vec2(v_pos_px.x, -v_pos_px.y);\n"
+    "     location.y += u_screen_size.y - size.y;\n"
     "     if(v_corner_radius != 0.0f) {"
-    "       display_color = opaque_color;\n"
-    "       vec2 location = vec2(v_pos_px.x, -v_pos_px.y);\n"
-    "       location.y += u_screen_size.y - size.y;\n"
     "       float edge_softness = 1.0f;\n"
     "       float radius = v_corner_radius * 2.0f;\n"
     "       float distance = rounded_box_sdf(gl_FragCoord.xy - location - (size/2.0f), size / 2.0f, radius);\n"
@@ -530,136 +1438,1191 @@ void renderer_init() {
     "           vec2 size_border = vec2(size.x - v_border_width * 2, size.y - v_border_width * 2);\n"
     "           float distance_border = rounded_box_sdf(gl_FragCoord.xy - location_border - (size_border / 2.0f), size_border / 2.0f, radius);\n"
     "           if(distance_border <= 0.0f) {\n"
-    "               fill_color = display_color.xyz;\n"
+    "               fill_color = opaque_color.xyz;\n"
     "           } else {\n"
     "               fill_color = v_border_color.xyz;\n"
     "           }\n"
-    "       } else {\n"
-    "           fill_color = display_color.xyz;\n"
+    "           return mix(vec4(0.0f, 0.0f, 0.0f, 0.0f), vec4(fill_color, smoothed_alpha), smoothed_alpha);\n"
     "       }\n"
-    "       if(v_border_width != 0.0f)\n" 
-    "         o_color =  mix(vec4(0.0f, 0.0f, 0.0f, 0.0f), vec4(fill_color, smoothed_alpha), smoothed_alpha);\n"
-    "       else\n" 
-    "         o_color = mix(vec4(0.0f, 0.0f, 0.0f, 0.0f), vec4(fill_color, display_color.a), smoothed_alpha);\n"
-    "     } else {\n"
-    "       vec4 fill_color = opaque_color;\n"
-    "       if(v_border_width != 0.0f) {\n"
-    "           vec2 location = vec2(v_pos_px.x, -v_pos_px.y);\n"
-    "           location.y += u_screen_size.y - size.y;\n"
-    "           vec2 location_border = vec2(location.x + v_border_width, location.y + v_border_width);\n"
-    "           vec2 size_border = vec2(v_scale.x - v_border_width * 2, v_scale.y - v_border_width * 2);\n"
-    "           float distance_border = rounded_box_sdf(gl_FragCoord.xy - location_border - (size_border / 2.0f), size_border / 2.0f, v_corner_radius);\n"
-    "           if(distance_border > 0.0f) {\n"
-    "               fill_color = v_border_color;\n"
+    "       return mix(vec4(0.0f, 0.0f, 0.0f, 0.0f), vec4(opaque_color.xyz, opaque_color.a), smoothed_alpha);\n"
+    "     }\n"
+    "     if(v_border_width != 0.0f) {\n"
+    "         vec2 location_border = vec2(location.x + v_border_width, location.y + v_border_width);\n"
+    "         vec2 size_border = vec2(v_scale.x - v_border_width * 2, v_scale.y - v_border_width * 2);\n"
+    "         float distance_border = rounded_box_sdf(gl_FragCoord.xy - location_border - (size_border / 2.0f), size_border / 2.0f, v_corner_radius);\n"
+    "         if(distance_border > 0.0f) {\n"
+    "             return v_border_color;\n"
+    "         }\n"
+    "     }\n"
+    "     return opaque_color;\n"
     "}\n"
+    "#endif\n"
+
+    "void main() {\n"
+    "#if defined(LF_SOLID)\n"
+    "     o_color = v_color;\n"
+    "#elif defined(LF_SHAPE)\n"
+    "     o_color = shade_shape(v_color);\n"
+    "#elif defined(LF_GLYPH)\n"
+    // The font atlas stores the coverage in every channel
+    "     o_color = v_color * texture(u_textures[v_tex_index], v_texcoord).r;\n"
+    "#elif defined(LF_GLYPH_SDF)\n"
+    // Thresholding the distance field with an edge that is one screen pixel wide at any scale
+    "     float dist = texture(u_textures[v_tex_index], v_texcoord).r;\n"
+    "     float edge = max(fwidth(dist) * 0.5f, 0.001f);\n"
+    "     o_color = v_color * smoothstep(0.5f - edge, 0.5f + edge, dist);\n"
+    "#else\n"
+    // LF_TEX_LAYER_BIT set = layer of an image texture array, the size class above LF_TEX_ARRAY_CLASS_SHIFT 
+    // picks the array (the gradients are taken before branching on it)
+    "     vec4 opaque_color;\n"
+    "     if((v_tex_index & 32768u) != 0u) {\n"
+    "       vec2 dx = dFdx(v_texcoord), dy = dFdy(v_texcoord);\n"
+    "       uint size_class = (v_tex_index & 32767u) >> LF_TEX_ARRAY_CLASS_SHIFT;\n"
+    "       vec3 coord = vec3(v_texcoord, float(v_tex_index & ((1u << LF_TEX_ARRAY_CLASS_SHIFT) - 1u)));\n"
+    "       vec4 texel = vec4(0.0f);\n"
+    "       for(uint i = 0u; i < LF_TEX_ARRAY_CLASSES; i++) {\n"
+    "         if(size_class == i) texel = textureGrad(u_tex_arrays[i], coord, dx, dy);\n"
     "       }\n"
-    "       o_color = fill_color;\n"
-    " }\n"
+    "       opaque_color = texel * v_color;\n"
+    "     } else {\n"
+    "       opaque_color = texture(u_textures[v_tex_index], v_texcoord) * v_color;\n"
+    "     }\n"
+    "     o_color = (v_corner_radius != 0.0f || v_border_width != 0.0f) ? shade_shape(opaque_color) : opaque_color;\n"
+    "#endif\n"
     "}\n";
-  state.render.shader = shader_prg_create(vert_src, frag_src);
-
-  // initializing vertex position data
-  state.render.vert_pos[0] = (vec4s){-0.5f, -0.5f, 0.0f, 1.0f};
-  state.render.vert_pos[1] = (vec4s){0.5f, -0.5f, 0.0f, 1.0f};
-  state.render.vert_pos[2] = (vec4s){0.5f, 0.5f, 0.0f, 1.0f};
-  state.render.vert_pos[3] = (vec4s){-0.5f, 0.5f, 0.0f, 1.0f};
 
+  // One fragment texture unit is taken by each image texture array
+  int32_t max_units;
+  glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &max_units);
+  if(state.config.tex_slots + LF_TEX_ARRAY_CLASSES > (uint32_t)max_units) {
+    // The default slot count takes whatever is left without a warning
+    if(state.config.tex_slots != MAX_TEX_COUNT_BATCH)
+      LF_WARN("Only %i texture units are available, using %i texture slots.", max_units, max_units - LF_TEX_ARRAY_CLASSES);
+    state.config.tex_slots = max_units - LF_TEX_ARRAY_CLASSES;
+  }
+  const uint32_t slot_count = state.config.tex_slots;
 
-  // Populating the textures array in the shader with texture ids
-  int32_t tex_slots[MAX_TEX_COUNT_BATCH];
-  for(uint32_t i = 0; i < MAX_TEX_COUNT_BATCH; i++) 
+  // Populating the textures array in the shaders with texture ids
+  int32_t tex_slots[LF_MAX_TEX_SLOTS];
+  for(uint32_t i = 0; i < slot_count; i++) 
     tex_slots[i] = i;
-
-  glUseProgram(state.render.shader.id);
+  int32_t array_slots[LF_TEX_ARRAY_CLASSES];
+  for(uint32_t i = 0; i < LF_TEX_ARRAY_CLASSES; i++) 
+    array_slots[i] = slot_count + i;
+
+  const char* pipeline_defines[LF_PIPELINE_COUNT] = {
+    [LF_PIPELINE_SOLID] = "LF_SOLID", 
+    [LF_PIPELINE_SHAPE] = "LF_SHAPE",
+    [LF_PIPELINE_GLYPH] = "LF_GLYPH", 
+    [LF_PIPELINE_IMAGE] = "LF_IMAGE",
+    [LF_PIPELINE_GLYPH_SDF] = "LF_GLYPH_SDF",
+  };
+  size_t frag_len = strlen(frag_src) + 256;
+  char* pipeline_src = (char*)mem_alloc(frag_len, LF_MEM_BACKEND);
+  for(uint32_t i = 0; i < LF_PIPELINE_COUNT; i++) {
+    snprintf(pipeline_src, frag_len, "#version 450 core\n#define %s\n#define LF_TEX_SLOTS %u\n"
+             "#define LF_TEX_ARRAY_CLASSES %uu\n#define LF_TEX_ARRAY_CLASS_SHIFT %uu\n%s", 
+             pipeline_defines[i], slot_count, LF_TEX_ARRAY_CLASSES, LF_TEX_ARRAY_CLASS_SHIFT, frag_src);
+    gl->shaders[i] = shader_prg_create(vert_src, pipeline_src);
+
+    glUseProgram(gl->shaders[i].id);
+    glUniform1iv(glGetUniformLocation(gl->shaders[i].id, "u_textures"), slot_count, tex_slots);
+    glUniform1iv(glGetUniformLocation(gl->shaders[i].id, "u_tex_arrays"), LF_TEX_ARRAY_CLASSES, array_slots);
+    glUniform1i(glGetUniformLocation(gl->shaders[i].id, "u_clips"), slot_count + LF_TEX_ARRAY_CLASSES);
+  }
+  mem_free(pipeline_src);
   set_projection_matrix();
-  glUniform1iv(glGetUniformLocation(state.render.shader.id, "u_textures"), MAX_TEX_COUNT_BATCH, tex_slots);
-}
 
-void renderer_begin() {
-  state.render.vert_count = 0;
-  state.render.index_count = 0;
-  state.render.tex_index = 0;
-  state.render.tex_count = 0;
-  state.drawcalls = 0;
+  // The image texture arrays are created when their first image is added
+  for(uint32_t i = 0; i < LF_TEX_ARRAY_CLASSES; i++) 
+    gl->tex_arrays[i].size = LF_TEX_ARRAY_MIN_SIZE << i;
+  return true;
 }
 
-void renderer_flush() {
-  if(state.render.vert_count <= 0) return;
-
-  // Bind the vertex buffer & shader set the vertex data, bind the textures & draw
-  glUseProgram(state.render.shader.id);
-  glBindBuffer(GL_ARRAY_BUFFER, state.render.vbo);
-  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * state.render.vert_count, 
-                  state.render.verts);
-
-  for(uint32_t i = 0; i < state.render.tex_count; i++) {
-    glBindTextureUnit(i, state.render.textures[i].id);
-    state.drawcalls++;
+void gl_backend_terminate(void* user_data) {
+  (void)user_data;
+  GLBackendState* gl = &state.render.gl;
+  for(uint32_t i = 0; i < LF_PIPELINE_COUNT; i++) 
+    glDeleteProgram(gl->shaders[i].id);
+  glDeleteVertexArrays(1, &gl->vao);
+  for(uint32_t i = 0; i < LF_STREAM_REGIONS; i++) {
+    if(gl->stream_fences[i]) glDeleteSync(gl->stream_fences[i]);
   }
-
-  vec2s renderSize = (vec2s){(float)state.dsp_w, (float)state.dsp_h};
-  glUniform2fv(glGetUniformLocation(state.render.shader.id, "u_screen_size"), 1, (float*)renderSize.raw);
-  glBindVertexArray(state.render.vao);
-  glDrawElements(GL_TRIANGLES, state.render.index_count, GL_UNSIGNED_INT, NULL);
+  glDeleteBuffers(1, &gl->vbo);
+  for(uint32_t i = 0; i < LF_TEX_ARRAY_CLASSES; i++) {
+    glDeleteTextures(1, &gl->tex_arrays[i].id);
+    mem_free(gl->tex_arrays[i].free_layers);
+  }
+  glDeleteTextures(1, &gl->clip_texture);
+  glDeleteBuffers(1, &gl->clip_buffer);
+  mem_free(gl->tex_layers);
+  memset(gl, 0, sizeof(*gl));
 }
 
-LfTextProps text_render_simple(vec2s pos, const char* text, LfFont font, LfColor font_color, bool no_render) {
-  return lf_text_render(pos, text, font, font_color, -1, (vec2s){-1, -1}, no_render, false, -1, -1);
-}
-LfTextProps text_render_simple_wide(vec2s pos, const wchar_t* text, LfFont font, LfColor font_color, bool no_render) {
-  return lf_text_render_wchar(pos, text, font, font_color, -1, (vec2s){-1, -1}, no_render, false, -1, -1);
+void gl_backend_resize(void* user_data, uint32_t display_width, uint32_t display_height) {
+  (void)user_data; (void)display_width; (void)display_height;
+  set_projection_matrix();
 }
 
+void gl_backend_instance_layout() {
+  // Setting the instance layout of the bound instance buffer (every attribute advances once per instance)
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, pos));
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, size));
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, texcoords));
+  glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, color));
+  glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, border_color));
+  glVertexAttribIPointer(5, 2, GL_UNSIGNED_SHORT, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, tex_index));
+  glVertexAttribIPointer(6, 3, GL_UNSIGNED_SHORT, sizeof(LfDrawInstance), (void*)(intptr_t)offsetof(LfDrawInstance, border_width));
+  for(uint32_t i = 0; i <= 6; i++) {
+    glEnableVertexAttribArray(i);
+    glVertexAttribDivisor(i, 1);
+  }
+}
 
-LfClickableItemState button(const char* file, int32_t line, vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width,  bool click_color, bool hover_color) {
-  return button_ex(file, line, pos, size, props, color, border_width, click_color, hover_color, (vec2s){-1, -1}); 
+void gl_backend_create_vbo() {
+  GLBackendState* gl = &state.render.gl;
+  gl->vbo_cap = state.config.batch_capacity;
+  glCreateBuffers(1, &gl->vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, gl->vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(LfDrawInstance) * gl->vbo_cap, NULL, 
+               GL_DYNAMIC_DRAW);
 }
-LfClickableItemState button_ex(const char* file, int32_t line, vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width, bool click_color, bool hover_color, vec2s hitbox_override) {
-  uint64_t id = DJB2_INIT;
-  id = djb2_hash(id, file, strlen(file));
-  id = djb2_hash(id, &line, sizeof(line));
-  if(state.element_id_stack != -1) {
-    id = djb2_hash(id, &state.element_id_stack, sizeof(state.element_id_stack));
-  }
 
-  if(item_should_cull((LfAABB){.pos = pos, .size= size})) {
-    return LF_IDLE;
+bool gl_backend_create_stream(uint32_t cap) {
+  // Creating one immutable instance buffer that holds LF_STREAM_REGIONS frames of cap instances and 
+  // keeping it mapped for the lifetime of the buffer
+  GLBackendState* gl = &state.render.gl;
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const GLsizeiptr size = sizeof(LfDrawInstance) * cap * LF_STREAM_REGIONS;
+
+  glCreateBuffers(1, &gl->vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, gl->vbo);
+  glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+  gl->stream_base = (LfDrawInstance*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+
+  if(!gl->stream_base) {
+    LF_WARN("Failed to persistently map the instance buffer, falling back to glBufferSubData uploads.");
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDeleteBuffers(1, &gl->vbo);
+    gl->vbo = 0;
+    return false;
   }
 
-  LfColor hover_color_rgb = hover_color ? (props.hover_color.a == 0.0f ? lf_color_brightness(color, 1.2) : props.hover_color) : color; 
-  LfColor held_color_rgb = click_color ? lf_color_brightness(color, 1.3) : color; 
-
-  bool is_hovered = lf_hovered(pos, (vec2s){hitbox_override.x != -1 ? hitbox_override.x : size.x,
-                                            hitbox_override.y != -1 ? hitbox_override.y : size.y});
-  if(state.active_element_id == 0) {
-    if(is_hovered && lf_mouse_button_went_down(GLFW_MOUSE_BUTTON_LEFT)) {
-      state.active_element_id = id;
+  memset(gl->stream_fences, 0, sizeof(gl->stream_fences));
+  gl->stream_region = 0;
+  gl->stream_cap = cap;
+  return true;
+}
+
+LfDrawInstance* gl_backend_instance_storage(void* user_data, uint32_t count) {
+  (void)user_data;
+  GLBackendState* gl = &state.render.gl;
+  if(!gl->streaming) return NULL;
+
+  if(count > gl->stream_cap) {
+    // Recreating the buffer with larger regions once the GPU is done with all of them
+    uint32_t cap = gl->stream_cap;
+    while(cap < count) cap *= 2;
+    glFinish();
+    for(uint32_t i = 0; i < LF_STREAM_REGIONS; i++) {
+      if(gl->stream_fences[i]) glDeleteSync(gl->stream_fences[i]);
+      gl->stream_fences[i] = NULL;
     }
-  } else if(state.active_element_id == id) {
-    if(is_hovered && lf_mouse_button_is_released(GLFW_MOUSE_BUTTON_LEFT)) {
-      lf_rect_render(pos, size, hover_color_rgb, props.border_color, border_width, props.corner_radius);
-      state.active_element_id = 0;
-      return LF_CLICKED;
+    glDeleteBuffers(1, &gl->vbo);
+    glBindVertexArray(gl->vao);
+    gl->streaming = gl_backend_create_stream(cap);
+    if(!gl->streaming) 
+      gl_backend_create_vbo();
+    gl_backend_instance_layout();
+    if(!gl->streaming) return NULL;
+  } else {
+    // Moving on to the next region & waiting until the GPU is done reading from it
+    gl->stream_region = (gl->stream_region + 1) % LF_STREAM_REGIONS;
+    GLsync fence = gl->stream_fences[gl->stream_region];
+    if(fence) {
+      GLenum res; 
+      do {
+        res = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+      } while(res == GL_TIMEOUT_EXPIRED);
+      glDeleteSync(fence);
+      gl->stream_fences[gl->stream_region] = NULL;
     }
   }
-  if(is_hovered && lf_mouse_button_is_released(GLFW_MOUSE_BUTTON_LEFT)) {
-    state.active_element_id = 0;
-  }
-  if(is_hovered && lf_mouse_button_is_down(GLFW_MOUSE_BUTTON_LEFT)) {
-    lf_rect_render(pos, size, held_color_rgb, props.border_color, border_width, props.corner_radius);
-    return LF_HELD;
-  }
-  if(is_hovered && (!lf_mouse_button_went_down(GLFW_MOUSE_BUTTON_LEFT) && !lf_mouse_button_is_down(GLFW_MOUSE_BUTTON_LEFT))) {
-    lf_rect_render(pos, size, hover_color ? hover_color_rgb : color, props.border_color, border_width, props.corner_radius);
-    return LF_HOVERED;
-  }
-  lf_rect_render(pos, size, color, props.border_color, border_width, props.corner_radius);
-  return LF_IDLE;
-
+  return gl->stream_base + (size_t)gl->stream_region * gl->stream_cap;
 }
-LfClickableItemState div_container(vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width, bool click_color, bool hover_color) {
-  if(item_should_cull((LfAABB){.pos = pos, .size = size})) {
-    return LF_IDLE;
+
+void gl_backend_render(void* user_data, const LfDrawList* list) {
+  (void)user_data;
+  if(!list->instance_count) return;
+  GLBackendState* gl = &state.render.gl;
+
+  vec2s renderSize = (vec2s){(float)list->display_width, (float)list->display_height};
+  for(uint32_t i = 0; i < LF_PIPELINE_COUNT; i++) {
+    int32_t loc = glGetUniformLocation(gl->shaders[i].id, "u_screen_size");
+    if(loc != -1) 
+      glProgramUniform2fv(gl->shaders[i].id, loc, 1, (float*)renderSize.raw);
+  }
+  glBindVertexArray(gl->vao);
+
+  for(uint32_t i = 0; i < LF_TEX_ARRAY_CLASSES; i++) 
+    glBindTextureUnit(state.config.tex_slots + i, gl->tex_arrays[i].id);
+
+  // Uploading the clip table
+  if(list->clip_count > gl->clip_cap) {
+    while(gl->clip_cap < list->clip_count) gl->clip_cap *= 2;
+    glNamedBufferData(gl->clip_buffer, sizeof(LfAABB) * gl->clip_cap, NULL, GL_DYNAMIC_DRAW);
+    glTextureBuffer(gl->clip_texture, GL_RGBA32F, gl->clip_buffer);
+  }
+  glNamedBufferSubData(gl->clip_buffer, 0, sizeof(LfAABB) * list->clip_count, list->clips);
+  state.render.stats.upload_bytes += sizeof(LfAABB) * list->clip_count;
+  glBindTextureUnit(state.config.tex_slots + LF_TEX_ARRAY_CLASSES, gl->clip_texture);
+
+  // Uploading the instances of the whole frame at once, streamed frames were written 
+  // into their mapped region by lf_end()
+  if(!gl->streaming) {
+    glBindBuffer(GL_ARRAY_BUFFER, gl->vbo);
+    if(list->instance_count > gl->vbo_cap) {
+      while(gl->vbo_cap < list->instance_count) gl->vbo_cap *= 2;
+      glBufferData(GL_ARRAY_BUFFER, sizeof(LfDrawInstance) * gl->vbo_cap, NULL, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(LfDrawInstance) * list->instance_count, list->instances);
+  }
+  state.render.stats.upload_bytes += sizeof(LfDrawInstance) * list->instance_count;
+  const uint32_t base_instance = gl->streaming ? gl->stream_region * gl->stream_cap : 0;
+
+  // One draw call per command, runs of the same command share their texture slots
+  int32_t bound_pipeline = -1;
+  uint32_t bound_first_texture = UINT32_MAX, bound_texture_count = 0;
+  for(uint32_t i = 0; i < list->cmd_count; i++) {
+    const LfDrawCmd* cmd = &list->cmds[i];
+    if(!cmd->instance_count) continue;
+    if((int32_t)cmd->pipeline != bound_pipeline) {
+      glUseProgram(gl->shaders[cmd->pipeline].id);
+      bound_pipeline = cmd->pipeline;
+    }
+    if(cmd->first_texture != bound_first_texture || cmd->texture_count != bound_texture_count) {
+      for(uint32_t j = 0; j < cmd->texture_count; j++) {
+        glBindTextureUnit(j, list->textures[cmd->first_texture + j].id);
+      }
+      bound_first_texture = cmd->first_texture;
+      bound_texture_count = cmd->texture_count;
+    }
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, cmd->instance_count, base_instance + cmd->first_instance);
+    state.render.stats.drawcalls++;
+  }
+
+  // Fencing the region of the frame, it's written to again LF_STREAM_REGIONS frames later
+  if(gl->streaming) 
+    gl->stream_fences[gl->stream_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void gl_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                               LfTextureFiltering filter, bool clamp) {
+  (void)user_data;
+  GLenum internal_format = (channels == 4) ? GL_RGBA8 : ((channels == 1) ? GL_R8 : GL_RGB8);
+  GLenum data_format = (channels == 4) ? GL_RGBA : ((channels == 1) ? GL_RED : GL_RGB);
+  // Font atlases are drawn 1:1 and change while in use, so they have no mipmaps
+  bool mipmaps = !clamp;
+
+  glGenTextures(1, &tex->id);
+
+  // Images that live in a texture array only reserve their id, font atlases are clamped and 
+  // always sampled through a texture slot. GL might hand out the id of a texture that was 
+  // deleted without lf_free_texture.
+  tex_array_remove(tex->id);
+  if(!clamp && tex_array_add(tex->id, tex->width, tex->height, channels, data, filter)) 
+    return;
+  glBindTexture(GL_TEXTURE_2D, tex->id); 
+
+  // Set texture parameters
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+  switch(filter) {
+    case LF_TEX_FILTER_LINEAR:
+      glTextureParameteri(tex->id, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+      glTextureParameteri(tex->id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      break;
+    case LF_TEX_FILTER_NEAREST:
+      glTextureParameteri(tex->id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTextureParameteri(tex->id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      break;
+  }
+
+  // Load texture data (rows of RGB images are not necessarily 4 byte aligned)
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, tex->width, tex->height, 0, data_format, GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if(mipmaps) 
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+  // Single channel textures read the value in every channel
+  if(channels == 1) {
+    GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_RED};
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+  }
+}
+
+void gl_backend_update_texture(void* user_data, LfTexture* tex, uint32_t x, uint32_t y, 
+                               uint32_t width, uint32_t height, const unsigned char* data, int32_t channels) {
+  (void)user_data;
+  glBindTexture(GL_TEXTURE_2D, tex->id);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, 
+                  (channels == 4) ? GL_RGBA : ((channels == 1) ? GL_RED : GL_RGB), GL_UNSIGNED_BYTE, data);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void gl_backend_delete_texture(void* user_data, LfTexture* tex) {
+  (void)user_data;
+  tex_array_remove(tex->id);
+  glDeleteTextures(1, &tex->id);
+}
+
+bool gl_backend_texture_layer(void* user_data, uint32_t tex_id, uint16_t* layer, vec2s* uv_max) {
+  (void)user_data;
+  TexLayer* entry = tex_array_find(tex_id);
+  if(!entry) return false;
+  *layer = entry->layer;
+  const float size = (float)state.render.gl.tex_arrays[entry->layer >> LF_TEX_ARRAY_CLASS_SHIFT].size;
+  *uv_max = (vec2s){(float)entry->width / size, (float)entry->height / size};
+  return true;
+}
+
+bool null_backend_init(void* user_data, uint32_t display_width, uint32_t display_height) {
+  (void)user_data; (void)display_width; (void)display_height;
+  return true;
+}
+
+void null_backend_render(void* user_data, const LfDrawList* list) {
+  // Nothing is drawn, the recorded list stays accessible through lf_get_draw_list()
+  (void)user_data; (void)list;
+}
+
+void null_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                                 LfTextureFiltering filter, bool clamp) {
+  (void)user_data; (void)data; (void)channels; (void)filter; (void)clamp;
+  // Handing out unique ids so texture slots still get assigned like with a real backend
+  static uint32_t id = 0;
+  tex->id = ++id;
+}
+
+// --- Software backend ---
+// Mirrors the fragment shader of the OpenGL backend on the CPU. Instances are binned 
+// into LF_SW_TILE_SIZE^2 tiles which are shaded in parallel, one row span at a time.
+float sw_rounded_box_sdf(float ax, float ay, float hx, float hy, float radius) {
+  float qx = fmaxf(ax - hx + radius, 0.0f);
+  float qy = fmaxf(ay - hy + radius, 0.0f);
+  return sqrtf(qx * qx + qy * qy) - radius;
+}
+
+void sw_span_scalar(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst) {
+  float ay = fabsf(py - p->cy);
+  for(int32_t i = 0; i < n; i++) {
+    float src[4];
+    for(uint32_t c = 0; c < 4; c++) 
+      src[c] = tex ? tex[c * LF_SW_TILE_SIZE + i] * p->color[c] : p->color[c];
+
+    float ax = fabsf((float)(x + i) + 0.5f - p->cx);
+    if(p->mode == SW_SHADE_BORDER) {
+      if(ax > p->hx - p->border_width || ay > p->hy - p->border_width) 
+        memcpy(src, p->border_color, sizeof(src));
+    } else if(p->mode == SW_SHADE_ROUNDED) {
+      float t = fminf(fmaxf(sw_rounded_box_sdf(ax, ay, p->hx, p->hy, p->radius) * 0.5f, 0.0f), 1.0f);
+      float alpha = 1.0f - t * t * (3.0f - 2.0f * t);
+      if(p->border_width != 0.0f) {
+        if(sw_rounded_box_sdf(ax, ay, p->hx - p->border_width, p->hy - p->border_width, p->radius) > 0.0f)
+          memcpy(src, p->border_color, sizeof(float) * 3);
+        src[3] = alpha;
+      }
+      for(uint32_t c = 0; c < 4; c++) src[c] *= alpha;
+    }
+
+    // Blending like glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+    uint8_t* px = &dst[i * 4];
+    for(uint32_t c = 0; c < 4; c++) {
+      float v = src[c] * src[3] + (px[c] / 255.0f) * (1.0f - src[3]);
+      px[c] = (uint8_t)lrintf(fminf(fmaxf(v, 0.0f), 1.0f) * 255.0f);
+    }
+  }
+}
+
+#ifdef LF_SW_X86
+void sw_span_sse(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst) {
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  const __m128 to_unorm = _mm_set1_ps(1.0f / 255.0f), from_unorm = _mm_set1_ps(255.0f);
+  const __m128i byte_mask = _mm_set1_epi32(0xff);
+  const __m128 ay = _mm_set1_ps(fabsf(py - p->cy));
+  const __m128 cx = _mm_set1_ps(p->cx);
+  const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+  // The last pixels of the span are shaded in a temporary buffer, the texture buffer is 
+  // LF_SW_TILE_SIZE floats per channel so the loads of the last iteration stay in bounds
+  uint8_t tmp[4 * 4];
+  for(int32_t i = 0; i < n; i += 4) {
+    int32_t count = n - i < 4 ? n - i : 4;
+    uint8_t* pixels = &dst[i * 4];
+    if(count < 4) {
+      memcpy(tmp, pixels, count * 4);
+      pixels = tmp;
+    }
+
+    __m128 s[4];
+    for(uint32_t c = 0; c < 4; c++) {
+      s[c] = _mm_set1_ps(p->color[c]);
+      if(tex) s[c] = _mm_mul_ps(s[c], _mm_loadu_ps(&tex[c * LF_SW_TILE_SIZE + i]));
+    }
+    __m128 ax = _mm_and_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps((float)(x + i)), lanes), cx), abs_mask);
+
+    if(p->mode == SW_SHADE_BORDER) {
+      __m128 m = _mm_or_ps(_mm_cmpgt_ps(ax, _mm_set1_ps(p->hx - p->border_width)), 
+                           _mm_cmpgt_ps(ay, _mm_set1_ps(p->hy - p->border_width)));
+      for(uint32_t c = 0; c < 4; c++) 
+        s[c] = _mm_or_ps(_mm_and_ps(m, _mm_set1_ps(p->border_color[c])), _mm_andnot_ps(m, s[c]));
+    } else if(p->mode == SW_SHADE_ROUNDED) {
+      const __m128 r = _mm_set1_ps(p->radius);
+      __m128 qx = _mm_max_ps(_mm_add_ps(_mm_sub_ps(ax, _mm_set1_ps(p->hx)), r), zero);
+      __m128 qy = _mm_max_ps(_mm_add_ps(_mm_sub_ps(ay, _mm_set1_ps(p->hy)), r), zero);
+      __m128 d = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy))), r);
+      __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(d, _mm_set1_ps(0.5f)), zero), one);
+      __m128 alpha = _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t))));
+      if(p->border_width != 0.0f) {
+        qx = _mm_max_ps(_mm_add_ps(_mm_sub_ps(ax, _mm_set1_ps(p->hx - p->border_width)), r), zero);
+        qy = _mm_max_ps(_mm_add_ps(_mm_sub_ps(ay, _mm_set1_ps(p->hy - p->border_width)), r), zero);
+        __m128 db = _mm_sub_ps(_mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy))), r);
+        __m128 m = _mm_cmpgt_ps(db, zero);
+        for(uint32_t c = 0; c < 3; c++) 
+          s[c] = _mm_or_ps(_mm_and_ps(m, _mm_set1_ps(p->border_color[c])), _mm_andnot_ps(m, s[c]));
+        s[3] = alpha;
+      }
+      for(uint32_t c = 0; c < 4; c++) s[c] = _mm_mul_ps(s[c], alpha);
+    }
+
+    // Unpacking 4 RGBA8 pixels, blending & packing them again
+    __m128i px = _mm_loadu_si128((const __m128i*)pixels);
+    __m128 inv_a = _mm_sub_ps(one, s[3]);
+    __m128i out = _mm_setzero_si128();
+    for(uint32_t c = 0; c < 4; c++) {
+      __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, c * 8), byte_mask)), to_unorm);
+      __m128 v = _mm_add_ps(_mm_mul_ps(s[c], s[3]), _mm_mul_ps(d, inv_a));
+      v = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), from_unorm);
+      out = _mm_or_si128(out, _mm_slli_epi32(_mm_cvtps_epi32(v), c * 8));
+    }
+    _mm_storeu_si128((__m128i*)pixels, out);
+    if(count < 4) 
+      memcpy(&dst[i * 4], tmp, count * 4);
+  }
+}
+#endif
+
+#ifdef LF_SW_AVX2
+__attribute__((target("avx2")))
+void sw_span_avx2(const SwPrim* p, float py, int32_t x, int32_t n, const float* tex, uint8_t* dst) {
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+  const __m256 to_unorm = _mm256_set1_ps(1.0f / 255.0f), from_unorm = _mm256_set1_ps(255.0f);
+  const __m256i byte_mask = _mm256_set1_epi32(0xff);
+  const __m256 ay = _mm256_set1_ps(fabsf(py - p->cy));
+  const __m256 cx = _mm256_set1_ps(p->cx);
+  const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+  // The last pixels of the span are shaded in a temporary buffer, the texture buffer is 
+  // LF_SW_TILE_SIZE floats per channel so the loads of the last iteration stay in bounds
+  uint8_t tmp[8 * 4];
+  for(int32_t i = 0; i < n; i += 8) {
+    int32_t count = n - i < 8 ? n - i : 8;
+    uint8_t* pixels = &dst[i * 4];
+    if(count < 8) {
+      memcpy(tmp, pixels, count * 4);
+      pixels = tmp;
+    }
+
+    __m256 s[4];
+    for(uint32_t c = 0; c < 4; c++) {
+      s[c] = _mm256_set1_ps(p->color[c]);
+      if(tex) s[c] = _mm256_mul_ps(s[c], _mm256_loadu_ps(&tex[c * LF_SW_TILE_SIZE + i]));
+    }
+    __m256 ax = _mm256_and_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)(x + i)), lanes), cx), abs_mask);
+
+    if(p->mode == SW_SHADE_BORDER) {
+      __m256 m = _mm256_or_ps(_mm256_cmp_ps(ax, _mm256_set1_ps(p->hx - p->border_width), _CMP_GT_OQ), 
+                              _mm256_cmp_ps(ay, _mm256_set1_ps(p->hy - p->border_width), _CMP_GT_OQ));
+      for(uint32_t c = 0; c < 4; c++) 
+        s[c] = _mm256_blendv_ps(s[c], _mm256_set1_ps(p->border_color[c]), m);
+    } else if(p->mode == SW_SHADE_ROUNDED) {
+      const __m256 r = _mm256_set1_ps(p->radius);
+      __m256 qx = _mm256_max_ps(_mm256_add_ps(_mm256_sub_ps(ax, _mm256_set1_ps(p->hx)), r), zero);
+      __m256 qy = _mm256_max_ps(_mm256_add_ps(_mm256_sub_ps(ay, _mm256_set1_ps(p->hy)), r), zero);
+      __m256 d = _mm256_sub_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy))), r);
+      __m256 t = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(d, _mm256_set1_ps(0.5f)), zero), one);
+      __m256 alpha = _mm256_sub_ps(one, _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_sub_ps(_mm256_set1_ps(3.0f), _mm256_add_ps(t, t))));
+      if(p->border_width != 0.0f) {
+        qx = _mm256_max_ps(_mm256_add_ps(_mm256_sub_ps(ax, _mm256_set1_ps(p->hx - p->border_width)), r), zero);
+        qy = _mm256_max_ps(_mm256_add_ps(_mm256_sub_ps(ay, _mm256_set1_ps(p->hy - p->border_width)), r), zero);
+        __m256 db = _mm256_sub_ps(_mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(qx, qx), _mm256_mul_ps(qy, qy))), r);
+        __m256 m = _mm256_cmp_ps(db, zero, _CMP_GT_OQ);
+        for(uint32_t c = 0; c < 3; c++) 
+          s[c] = _mm256_blendv_ps(s[c], _mm256_set1_ps(p->border_color[c]), m);
+        s[3] = alpha;
+      }
+      for(uint32_t c = 0; c < 4; c++) s[c] = _mm256_mul_ps(s[c], alpha);
+    }
+
+    // Unpacking 8 RGBA8 pixels, blending & packing them again
+    __m256i px = _mm256_loadu_si256((const __m256i*)pixels);
+    __m256 inv_a = _mm256_sub_ps(one, s[3]);
+    __m256i out = _mm256_setzero_si256();
+    for(uint32_t c = 0; c < 4; c++) {
+      __m256 d = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, c * 8), byte_mask)), to_unorm);
+      __m256 v = _mm256_add_ps(_mm256_mul_ps(s[c], s[3]), _mm256_mul_ps(d, inv_a));
+      v = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(v, zero), one), from_unorm);
+      out = _mm256_or_si256(out, _mm256_slli_epi32(_mm256_cvtps_epi32(v), c * 8));
+    }
+    _mm256_storeu_si256((__m256i*)pixels, out);
+    if(count < 8) 
+      memcpy(&dst[i * 4], tmp, count * 4);
+  }
+}
+#endif
+
+void sw_sample_span(const SwPrim* p, float py, int32_t x, int32_t n, float* tex) {
+  const SwTexture* t = p->tex;
+  const int32_t w = t->width, h = t->height;
+  float v = p->v0 + p->dv * py;
+  for(int32_t i = 0; i < n; i++) {
+    float u = p->u0 + p->du * ((float)(x + i) + 0.5f);
+    const uint8_t* texels[4];
+    float wx = 0.0f, wy = 0.0f;
+    if(t->nearest) {
+      int32_t tx = (int32_t)floorf(u * t->width), ty = (int32_t)floorf(v * t->height);
+      tx = t->clamp ? (tx < 0 ? 0 : (tx >= w ? w - 1 : tx)) : ((tx % w) + w) % w;
+      ty = t->clamp ? (ty < 0 ? 0 : (ty >= h ? h - 1 : ty)) : ((ty % h) + h) % h;
+      texels[0] = texels[1] = texels[2] = texels[3] = &t->pixels[(ty * w + tx) * 4];
+    } else {
+      // Bilinear filtering of the base level
+      float fx = u * t->width - 0.5f, fy = v * t->height - 0.5f;
+      int32_t tx[2], ty[2];
+      tx[0] = (int32_t)floorf(fx);
+      ty[0] = (int32_t)floorf(fy);
+      wx = fx - tx[0];
+      wy = fy - ty[0];
+      tx[1] = tx[0] + 1;
+      ty[1] = ty[0] + 1;
+      for(uint32_t k = 0; k < 2; k++) {
+        tx[k] = t->clamp ? (tx[k] < 0 ? 0 : (tx[k] >= w ? w - 1 : tx[k])) : ((tx[k] % w) + w) % w;
+        ty[k] = t->clamp ? (ty[k] < 0 ? 0 : (ty[k] >= h ? h - 1 : ty[k])) : ((ty[k] % h) + h) % h;
+      }
+      texels[0] = &t->pixels[(ty[0] * w + tx[0]) * 4];
+      texels[1] = &t->pixels[(ty[0] * w + tx[1]) * 4];
+      texels[2] = &t->pixels[(ty[1] * w + tx[0]) * 4];
+      texels[3] = &t->pixels[(ty[1] * w + tx[1]) * 4];
+    }
+    for(uint32_t c = 0; c < 4; c++) {
+      float top = texels[0][c] + (texels[1][c] - texels[0][c]) * wx;
+      float bottom = texels[2][c] + (texels[3][c] - texels[2][c]) * wx;
+      tex[c * LF_SW_TILE_SIZE + i] = (top + (bottom - top) * wy) / 255.0f;
+    }
+  }
+}
+
+void sw_sdf_span(const SwPrim* p, int32_t n, float* tex) {
+  // Turning the sampled distances into coverage (smoothstep like the GL glyph shader)
+  float lo = 0.5f - p->sdf_edge, inv = 1.0f / (2.0f * p->sdf_edge);
+  for(int32_t i = 0; i < n; i++) {
+    float t = (tex[i] - lo) * inv;
+    t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+    t = t * t * (3.0f - 2.0f * t);
+    for(uint32_t c = 0; c < 4; c++) 
+      tex[c * LF_SW_TILE_SIZE + i] = t;
+  }
+}
+
+void sw_render_tile(uint32_t tile) {
+  SoftwareBackendState* sw = &state.render.sw;
+  int32_t tx0 = (tile % sw->tiles_x) * LF_SW_TILE_SIZE, ty0 = (tile / sw->tiles_x) * LF_SW_TILE_SIZE;
+  int32_t tx1 = tx0 + LF_SW_TILE_SIZE, ty1 = ty0 + LF_SW_TILE_SIZE;
+  if(tx1 > (int32_t)sw->width) tx1 = sw->width;
+  if(ty1 > (int32_t)sw->height) ty1 = sw->height;
+
+  // Clearing the tile
+  uint8_t clear[4] = {sw->clear_color.r, sw->clear_color.g, sw->clear_color.b, sw->clear_color.a};
+  for(int32_t y = ty0; y < ty1; y++) {
+    uint8_t* row = &sw->pixels[((size_t)y * sw->width + tx0) * 4];
+    for(int32_t x = 0; x < tx1 - tx0; x++) memcpy(&row[x * 4], clear, 4);
+  }
+
+  float tex[4 * LF_SW_TILE_SIZE];
+  const SwBin* bin = &sw->bins[tile];
+  for(uint32_t i = 0; i < bin->count; i++) {
+    const SwPrim* p = &sw->prims[bin->prims[i]];
+    int32_t x0 = p->x0 > tx0 ? p->x0 : tx0, x1 = p->x1 < tx1 ? p->x1 : tx1;
+    int32_t y0 = p->y0 > ty0 ? p->y0 : ty0, y1 = p->y1 < ty1 ? p->y1 : ty1;
+    for(int32_t y = y0; y < y1; y++) {
+      float py = (float)y + 0.5f;
+      uint8_t* row = &sw->pixels[(size_t)y * sw->width * 4];
+      if(p->hollow && fabsf(py - p->cy) <= p->hy - p->border_width) {
+        // Skipping the inside of bordered rects without a fill
+        int32_t ix0 = (int32_t)ceilf(p->cx - (p->hx - p->border_width) - 0.5f);
+        int32_t ix1 = (int32_t)floorf(p->cx + (p->hx - p->border_width) - 0.5f) + 1;
+        if(ix0 > x0) sw->span(p, py, x0, (ix0 < x1 ? ix0 : x1) - x0, NULL, &row[x0 * 4]);
+        if(ix1 < x1) sw->span(p, py, ix1 > x0 ? ix1 : x0, x1 - (ix1 > x0 ? ix1 : x0), NULL, &row[(ix1 > x0 ? ix1 : x0) * 4]);
+        continue;
+      }
+      if(p->tex) sw_sample_span(p, py, x0, x1 - x0, tex);
+      if(p->sdf_edge != 0.0f) sw_sdf_span(p, x1 - x0, tex);
+      sw->span(p, py, x0, x1 - x0, p->tex ? tex : NULL, &row[x0 * 4]);
+    }
+  }
+}
+
+void sw_render_tiles() {
+  // Tiles are handed out through an atomic counter
+  SoftwareBackendState* sw = &state.render.sw;
+  uint32_t tile_count = sw->tiles_x * sw->tiles_y;
+  while(true) {
+#ifdef LF_SW_THREADS
+    uint32_t tile = __atomic_fetch_add(&sw->next_tile, 1, __ATOMIC_RELAXED);
+#else 
+    uint32_t tile = sw->next_tile++;
+#endif
+    if(tile >= tile_count) break;
+    sw_render_tile(tile);
+  }
+}
+
+#ifdef LF_SW_THREADS
+void* sw_worker(void* arg) {
+  (void)arg;
+  SoftwareBackendState* sw = &state.render.sw;
+  uint32_t generation = 0;
+  while(true) {
+    pthread_mutex_lock(&sw->mutex);
+    while(sw->generation == generation && !sw->quit) 
+      pthread_cond_wait(&sw->work_cond, &sw->mutex);
+    if(sw->quit) {
+      pthread_mutex_unlock(&sw->mutex);
+      break;
+    }
+    generation = sw->generation;
+    pthread_mutex_unlock(&sw->mutex);
+
+    sw_render_tiles();
+
+    pthread_mutex_lock(&sw->mutex);
+    if(--sw->busy == 0) 
+      pthread_cond_signal(&sw->done_cond);
+    pthread_mutex_unlock(&sw->mutex);
+  }
+  return NULL;
+}
+#endif
+
+void sw_resize_framebuffer(uint32_t width, uint32_t height) {
+  SoftwareBackendState* sw = &state.render.sw;
+  for(uint32_t i = 0; i < sw->tiles_x * sw->tiles_y; i++) 
+    mem_free(sw->bins[i].prims);
+  mem_free(sw->bins);
+
+  sw->width = width;
+  sw->height = height;
+  sw->pixels = (uint8_t*)mem_realloc(sw->pixels, (size_t)width * height * 4, LF_MEM_BACKEND);
+  sw->tiles_x = (width + LF_SW_TILE_SIZE - 1) / LF_SW_TILE_SIZE;
+  sw->tiles_y = (height + LF_SW_TILE_SIZE - 1) / LF_SW_TILE_SIZE;
+  sw->bins = (SwBin*)mem_calloc(sw->tiles_x * sw->tiles_y, sizeof(SwBin), LF_MEM_BACKEND);
+}
+
+bool sw_backend_init(void* user_data, uint32_t display_width, uint32_t display_height) {
+  SoftwareBackendState* sw = &state.render.sw;
+  sw->clear_color = (LfColor){0, 0, 0, 255};
+  sw_resize_framebuffer(display_width, display_height);
+
+  // Picking the widest span kernel the CPU supports
+  sw->span = sw_span_scalar;
+#ifdef LF_SW_X86
+  sw->span = sw_span_sse;
+#endif
+#ifdef LF_SW_AVX2
+  if(__builtin_cpu_supports("avx2")) 
+    sw->span = sw_span_avx2;
+#endif
+
+#ifdef LF_SW_THREADS
+  // The calling thread works on tiles as well
+  uint32_t thread_count = (uint32_t)(uintptr_t)user_data;
+  if(!thread_count) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = cores > 0 ? (uint32_t)cores : 1;
+  }
+  pthread_mutex_init(&sw->mutex, NULL);
+  pthread_cond_init(&sw->work_cond, NULL);
+  pthread_cond_init(&sw->done_cond, NULL);
+  sw->threads = (pthread_t*)mem_alloc(sizeof(pthread_t) * thread_count, LF_MEM_BACKEND);
+  for(uint32_t i = 0; i < thread_count - 1; i++) {
+    if(pthread_create(&sw->threads[sw->thread_count], NULL, sw_worker, NULL) == 0) 
+      sw->thread_count++;
+  }
+#else 
+  (void)user_data;
+#endif
+  return true;
+}
+
+void sw_backend_terminate(void* user_data) {
+  (void)user_data;
+  SoftwareBackendState* sw = &state.render.sw;
+#ifdef LF_SW_THREADS
+  pthread_mutex_lock(&sw->mutex);
+  sw->quit = true;
+  pthread_cond_broadcast(&sw->work_cond);
+  pthread_mutex_unlock(&sw->mutex);
+  for(uint32_t i = 0; i < sw->thread_count; i++) 
+    pthread_join(sw->threads[i], NULL);
+  mem_free(sw->threads);
+  pthread_mutex_destroy(&sw->mutex);
+  pthread_cond_destroy(&sw->work_cond);
+  pthread_cond_destroy(&sw->done_cond);
+#endif
+  for(uint32_t i = 0; i < sw->tiles_x * sw->tiles_y; i++) 
+    mem_free(sw->bins[i].prims);
+  mem_free(sw->bins);
+  for(uint32_t i = 0; i < sw->texture_count; i++) 
+    mem_free(sw->textures[i].pixels);
+  mem_free(sw->textures);
+  mem_free(sw->free_textures);
+  mem_free(sw->prims);
+  mem_free(sw->pixels);
+  memset(sw, 0, sizeof(*sw));
+}
+
+void sw_backend_resize(void* user_data, uint32_t display_width, uint32_t display_height) {
+  (void)user_data;
+  sw_resize_framebuffer(display_width, display_height);
+}
+
+void sw_backend_render(void* user_data, const LfDrawList* list) {
+  (void)user_data;
+  SoftwareBackendState* sw = &state.render.sw;
+  if(list->instance_count > sw->prim_cap) {
+    sw->prim_cap = list->instance_count;
+    sw->prims = (SwPrim*)mem_realloc(sw->prims, sizeof(SwPrim) * sw->prim_cap, LF_MEM_BACKEND);
+  }
+  for(uint32_t i = 0; i < sw->tiles_x * sw->tiles_y; i++) 
+    sw->bins[i].count = 0;
+
+  // Setting up the instances & binning them into tiles (in painter's order)
+  uint32_t prim_count = 0;
+  for(uint32_t c = 0; c < list->cmd_count; c++) {
+    const LfDrawCmd* cmd = &list->cmds[c];
+    for(uint32_t i = cmd->first_instance; i < cmd->first_instance + cmd->instance_count; i++) {
+      const LfDrawInstance* inst = &list->instances[i];
+      SwPrim* p = &sw->prims[prim_count];
+
+      float radius = inst->corner_radius / LF_FIXED_POINT_SCALE;
+      float border_width = inst->border_width / LF_FIXED_POINT_SCALE;
+      float margin = radius != 0.0f ? 2.0f : 0.0f;
+
+      // Pixels whose center lies inside of the (grown) quad & the clipping area
+      p->x0 = (int32_t)ceilf(inst->pos[0] - margin - 0.5f);
+      p->y0 = (int32_t)ceilf(inst->pos[1] - margin - 0.5f);
+      p->x1 = (int32_t)ceilf(inst->pos[0] + inst->size[0] + margin - 0.5f);
+      p->y1 = (int32_t)ceilf(inst->pos[1] + inst->size[1] + margin - 0.5f);
+      const LfAABB* clip = &list->clips[inst->clip_index];
+      p->x0 = fmaxf(p->x0, ceilf(clip->pos.x - 0.5f));
+      p->y0 = fmaxf(p->y0, ceilf(clip->pos.y - 0.5f));
+      p->x1 = fminf(p->x1, floorf(clip->pos.x + clip->size.x - 0.5f) + 1.0f);
+      p->y1 = fminf(p->y1, floorf(clip->pos.y + clip->size.y - 0.5f) + 1.0f);
+      if(p->x0 < 0) p->x0 = 0;
+      if(p->y0 < 0) p->y0 = 0;
+      if(p->x1 > (int32_t)sw->width) p->x1 = sw->width;
+      if(p->y1 > (int32_t)sw->height) p->y1 = sw->height;
+      if(p->x0 >= p->x1 || p->y0 >= p->y1) continue;
+
+      p->tex = NULL;
+      if(inst->tex_index != LF_NO_TEXTURE && !(inst->tex_index & LF_TEX_LAYER_BIT)) {
+        uint32_t id = list->textures[cmd->first_texture + inst->tex_index].id;
+        if(id && id <= sw->texture_count && sw->textures[id - 1].pixels) 
+          p->tex = &sw->textures[id - 1];
+      }
+      for(uint32_t k = 0; k < 4; k++) {
+        p->color[k] = inst->color[k] / 255.0f;
+        p->border_color[k] = inst->border_color[k] / 255.0f;
+      }
+      // Fully transparent untextured rects don't change the framebuffer
+      if(!p->tex && radius == 0.0f && inst->color[3] == 0 && 
+        (border_width == 0.0f || inst->border_color[3] == 0)) continue;
+
+      p->hx = inst->size[0] / 2.0f;
+      p->hy = inst->size[1] / 2.0f;
+      p->cx = inst->pos[0] + p->hx;
+      p->cy = inst->pos[1] + p->hy;
+      p->radius = radius * 2.0f;
+      p->border_width = border_width;
+      p->mode = radius != 0.0f ? SW_SHADE_ROUNDED : (border_width != 0.0f ? SW_SHADE_BORDER : SW_SHADE_FLAT);
+      p->hollow = p->mode == SW_SHADE_BORDER && !p->tex && inst->color[3] == 0;
+
+      // Texture coordinates are interpolated linearly across the quad
+      float s0 = inst->texcoords[0] / 65535.0f, t0 = inst->texcoords[1] / 65535.0f;
+      float s1 = inst->texcoords[2] / 65535.0f, t1 = inst->texcoords[3] / 65535.0f;
+      p->du = inst->size[0] > 0.0001f ? (s1 - s0) / inst->size[0] : 0.0f;
+      p->dv = inst->size[1] > 0.0001f ? (t1 - t0) / inst->size[1] : 0.0f;
+      p->u0 = s0 - p->du * inst->pos[0];
+      p->v0 = t0 - p->dv * inst->pos[1];
+
+      // The distance changes by LF_SDF_ONEDGE / LF_SDF_PADDING per texel, the edge is one pixel wide
+      p->sdf_edge = 0.0f;
+      if(inst->flags == LF_PIPELINE_GLYPH_SDF && p->tex) 
+        p->sdf_edge = fmaxf(0.5f * p->du * p->tex->width * ((float)LF_SDF_ONEDGE / LF_SDF_PADDING) / 255.0f, 0.001f);
+
+      for(int32_t ty = p->y0 / LF_SW_TILE_SIZE; ty <= (p->y1 - 1) / LF_SW_TILE_SIZE; ty++) {
+        for(int32_t tx = p->x0 / LF_SW_TILE_SIZE; tx <= (p->x1 - 1) / LF_SW_TILE_SIZE; tx++) {
+          SwBin* bin = &sw->bins[ty * sw->tiles_x + tx];
+          if(bin->count >= bin->cap) {
+            bin->cap = bin->cap ? bin->cap * 2 : 64;
+            bin->prims = (uint32_t*)mem_realloc(bin->prims, sizeof(uint32_t) * bin->cap, LF_MEM_BACKEND);
+          }
+          bin->prims[bin->count++] = prim_count;
+        }
+      }
+      prim_count++;
+    }
+  }
+
+  // Shading the tiles on all threads
+  sw->next_tile = 0;
+#ifdef LF_SW_THREADS
+  if(sw->thread_count) {
+    pthread_mutex_lock(&sw->mutex);
+    sw->busy = sw->thread_count;
+    sw->generation++;
+    pthread_cond_broadcast(&sw->work_cond);
+    pthread_mutex_unlock(&sw->mutex);
+
+    sw_render_tiles();
+
+    pthread_mutex_lock(&sw->mutex);
+    while(sw->busy) 
+      pthread_cond_wait(&sw->done_cond, &sw->mutex);
+    pthread_mutex_unlock(&sw->mutex);
+  } else 
+#endif
+  {
+    sw_render_tiles();
+  }
+  state.render.stats.drawcalls += list->cmd_count;
+}
+
+void sw_backend_create_texture(void* user_data, LfTexture* tex, const unsigned char* data, int32_t channels, 
+                               LfTextureFiltering filter, bool clamp) {
+  (void)user_data;
+  SoftwareBackendState* sw = &state.render.sw;
+
+  // Reusing the slot of a deleted texture
+  uint32_t index;
+  if(sw->free_texture_count) {
+    index = sw->free_textures[--sw->free_texture_count];
+  } else {
+    if(sw->texture_count >= sw->texture_cap) {
+      sw->texture_cap = sw->texture_cap ? sw->texture_cap * 2 : 16;
+      sw->textures = (SwTexture*)mem_realloc(sw->textures, sizeof(SwTexture) * sw->texture_cap, LF_MEM_BACKEND);
+      sw->free_textures = (uint32_t*)mem_realloc(sw->free_textures, sizeof(uint32_t) * sw->texture_cap, LF_MEM_BACKEND);
+    }
+    index = sw->texture_count++;
+  }
+
+  // Textures are stored as RGBA8, single channel textures hold the value in every channel
+  SwTexture* t = &sw->textures[index];
+  t->width = tex->width;
+  t->height = tex->height;
+  t->clamp = clamp;
+  t->nearest = filter == LF_TEX_FILTER_NEAREST;
+  t->pixels = (uint8_t*)mem_alloc((size_t)t->width * t->height * 4, LF_MEM_BACKEND);
+  for(size_t i = 0; i < (size_t)t->width * t->height; i++) {
+    for(int32_t c = 0; c < 4; c++) 
+      t->pixels[i * 4 + c] = (!data) ? 0 : (channels == 1 ? data[i] : (c < channels ? data[i * channels + c] : 255));
+  }
+  tex->id = index + 1;
+}
+
+void sw_backend_update_texture(void* user_data, LfTexture* tex, uint32_t x, uint32_t y, 
+                               uint32_t width, uint32_t height, const unsigned char* data, int32_t channels) {
+  (void)user_data;
+  SoftwareBackendState* sw = &state.render.sw;
+  if(!tex->id || tex->id > sw->texture_count || !sw->textures[tex->id - 1].pixels) return;
+  SwTexture* t = &sw->textures[tex->id - 1];
+  for(uint32_t row = 0; row < height && y + row < t->height; row++) {
+    uint8_t* dst = t->pixels + ((size_t)(y + row) * t->width + x) * 4;
+    const unsigned char* src = data + (size_t)row * width * channels;
+    for(uint32_t i = 0; i < width && x + i < t->width; i++) {
+      for(int32_t c = 0; c < 4; c++) 
+        dst[i * 4 + c] = channels == 1 ? src[i] : (c < channels ? src[i * channels + c] : 255);
+    }
+  }
+}
+
+void sw_backend_delete_texture(void* user_data, LfTexture* tex) {
+  (void)user_data;
+  SoftwareBackendState* sw = &state.render.sw;
+  if(!tex->id || tex->id > sw->texture_count || !sw->textures[tex->id - 1].pixels) return;
+  mem_free(sw->textures[tex->id - 1].pixels);
+  sw->textures[tex->id - 1].pixels = NULL;
+  sw->free_textures[sw->free_texture_count++] = tex->id - 1;
+}
+
+uint32_t png_crc(uint32_t crc, const uint8_t* buf, size_t size) {
+  static uint32_t table[256];
+  if(!table[1]) {
+    for(uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for(uint32_t k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+  }
+  crc = ~crc;
+  for(size_t i = 0; i < size; i++) crc = table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+void png_write_chunk(FILE* file, const char* type, const uint8_t* data, uint32_t size) {
+  uint8_t len[4] = {size >> 24, size >> 16, size >> 8, size};
+  fwrite(len, 1, 4, file);
+  fwrite(type, 1, 4, file);
+  if(size) fwrite(data, 1, size, file);
+  uint32_t crc = png_crc(png_crc(0, (const uint8_t*)type, 4), data, size);
+  uint8_t crc_bytes[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+  fwrite(crc_bytes, 1, 4, file);
+}
+
+TexLayer* tex_array_find(uint32_t id) {
+  if(!state.render.gl.tex_layer_cap || !id) return NULL;
+  const uint32_t mask = state.render.gl.tex_layer_cap - 1;
+  uint32_t i = (id * 2654435761u) & mask;
+  while(state.render.gl.tex_layers[i].id) {
+    if(state.render.gl.tex_layers[i].id == id) 
+      return &state.render.gl.tex_layers[i];
+    i = (i + 1) & mask;
+  }
+  return NULL;
+}
+
+void tex_layers_insert(TexLayer entry) {
+  // Keeping the load factor of the table below 1/2
+  if((state.render.gl.tex_layer_count + 1) * 2 > state.render.gl.tex_layer_cap) {
+    TexLayer* old = state.render.gl.tex_layers;
+    uint32_t old_cap = state.render.gl.tex_layer_cap;
+    state.render.gl.tex_layer_cap = old_cap ? old_cap * 2 : 64;
+    state.render.gl.tex_layers = (TexLayer*)mem_calloc(state.render.gl.tex_layer_cap, sizeof(TexLayer), LF_MEM_BACKEND);
+    state.render.gl.tex_layer_count = 0;
+    for(uint32_t i = 0; i < old_cap; i++) {
+      if(old[i].id) tex_layers_insert(old[i]);
+    }
+    mem_free(old);
+  }
+  const uint32_t mask = state.render.gl.tex_layer_cap - 1;
+  uint32_t i = (entry.id * 2654435761u) & mask;
+  while(state.render.gl.tex_layers[i].id && state.render.gl.tex_layers[i].id != entry.id) 
+    i = (i + 1) & mask;
+  if(!state.render.gl.tex_layers[i].id) 
+    state.render.gl.tex_layer_count++;
+  state.render.gl.tex_layers[i] = entry;
+}
+
+bool tex_array_grow(TexArray* array) {
+  int32_t max_layers;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+  max_layers = MIN(max_layers, 1 << LF_TEX_ARRAY_CLASS_SHIFT);
+
+  uint32_t layers = array->layers ? array->layers * 2 : LF_TEX_ARRAY_INIT_LAYERS;
+  if(layers > (uint32_t)max_layers) layers = max_layers;
+  if(layers <= array->layers) return false;
+
+  uint32_t levels = 1;
+  while((array->size >> levels) > 0) levels++;
+
+  uint32_t tex;
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &tex);
+  glTextureStorage3D(tex, levels, GL_RGBA8, array->size, array->size, layers);
+  glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  // Moving the existing layers (with all of their mip levels) over to the new array
+  if(array->id) {
+    for(uint32_t level = 0; level < levels; level++) {
+      glCopyImageSubData(array->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, 
+                         tex, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, 
+                         array->size >> level, array->size >> level, array->layers);
+    }
+    glDeleteTextures(1, &array->id);
+  }
+  array->id = tex;
+  array->layers = layers;
+  array->free_layers = (uint16_t*)mem_realloc(array->free_layers, sizeof(uint16_t) * layers, LF_MEM_BACKEND);
+  return true;
+}
+
+bool tex_array_add(uint32_t id, int32_t width, int32_t height, int32_t channels, const unsigned char* data, LfTextureFiltering filter) {
+  if(!state.init || !data || filter != LF_TEX_FILTER_LINEAR || (channels != 3 && channels != 4) ||
+    width <= 0 || height <= 0 || width > LF_TEX_ARRAY_LAYER_SIZE || height > LF_TEX_ARRAY_LAYER_SIZE) return false;
+
+  // Picking the smallest layers the image fits into
+  uint32_t size_class = 0;
+  while(state.render.gl.tex_arrays[size_class].size < (uint32_t)width || 
+    state.render.gl.tex_arrays[size_class].size < (uint32_t)height) size_class++;
+  TexArray* array = &state.render.gl.tex_arrays[size_class];
+
+  // Retrieving a free layer
+  uint32_t layer;
+  if(array->free_count) {
+    layer = array->free_layers[--array->free_count];
+  } else {
+    if(array->next_layer >= array->layers && !tex_array_grow(array)) return false;
+    layer = array->next_layer++;
+  }
+
+  tex_array_upload(array, layer, width, height, channels, data);
+  tex_layers_insert((TexLayer){.id = id, .layer = (uint16_t)((size_class << LF_TEX_ARRAY_CLASS_SHIFT) | layer), 
+                    .width = (uint16_t)width, .height = (uint16_t)height});
+  return true;
+}
+
+void tex_array_upload(const TexArray* array, uint32_t layer, uint32_t width, uint32_t height, 
+                      int32_t channels, const unsigned char* data) {
+  // Every mip level of the image is built from the one above & uploaded into the top left of 
+  // the layer with a one texel gutter that repeats the right column & bottom row. Bilinear 
+  // filtering at the image edges then behaves like GL_CLAMP_TO_EDGE at every level, the rest 
+  // of the layer is never sampled.
+  size_t level_bytes = (size_t)(width + 1) * (height + 1) * 4;
+  uint8_t* staging = (uint8_t*)mem_alloc(level_bytes * 2, LF_MEM_TEXTURE_STAGING);
+  uint8_t* level_data = staging, *next_data = staging + level_bytes;
+  for(uint32_t y = 0; y < height; y++) {
+    for(uint32_t x = 0; x < width; x++) {
+      const unsigned char* src = &data[((size_t)y * width + x) * channels];
+      uint8_t* dst = &level_data[((size_t)y * (width + 1) + x) * 4];
+      dst[0] = src[0];
+      dst[1] = src[1];
+      dst[2] = src[2];
+      dst[3] = channels == 4 ? src[3] : 255;
+    }
+  }
+
+  uint32_t w = width, h = height;
+  for(uint32_t level = 0, size = array->size; size > 0; level++, size >>= 1) {
+    // Rows of the level are w + 1 texels apart
+    const uint32_t pitch = w + 1;
+    for(uint32_t y = 0; y < h; y++) 
+      memcpy(&level_data[((size_t)y * pitch + w) * 4], &level_data[((size_t)y * pitch + w - 1) * 4], 4);
+    memcpy(&level_data[(size_t)h * pitch * 4], &level_data[(size_t)(h - 1) * pitch * 4], (size_t)pitch * 4);
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch);
+    glTextureSubImage3D(array->id, level, 0, 0, layer, w < size ? w + 1 : w, h < size ? h + 1 : h, 1, 
+                        GL_RGBA, GL_UNSIGNED_BYTE, level_data);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    // Averaging 2x2 texels into the next level, the image edge is repeated for odd sizes
+    uint32_t next_w = (w + 1) / 2, next_h = (h + 1) / 2;
+    for(uint32_t y = 0; y < next_h; y++) {
+      uint32_t y0 = y * 2, y1 = y0 + 1 < h ? y0 + 1 : y0;
+      for(uint32_t x = 0; x < next_w; x++) {
+        uint32_t x0 = x * 2, x1 = x0 + 1 < w ? x0 + 1 : x0;
+        const uint8_t* t00 = &level_data[((size_t)y0 * pitch + x0) * 4];
+        const uint8_t* t01 = &level_data[((size_t)y0 * pitch + x1) * 4];
+        const uint8_t* t10 = &level_data[((size_t)y1 * pitch + x0) * 4];
+        const uint8_t* t11 = &level_data[((size_t)y1 * pitch + x1) * 4];
+        uint8_t* dst = &next_data[((size_t)y * (next_w + 1) + x) * 4];
+        for(uint32_t c = 0; c < 4; c++) 
+          dst[c] = (uint8_t)((t00[c] + t01[c] + t10[c] + t11[c] + 2) / 4);
+      }
+    }
+    uint8_t* tmp = level_data;
+    level_data = next_data;
+    next_data = tmp;
+    w = next_w;
+    h = next_h;
+  }
+  mem_free(staging);
+}
+
+void tex_array_remove(uint32_t id) {
+  TexLayer* entry = tex_array_find(id);
+  if(!entry) return;
+
+  TexArray* array = &state.render.gl.tex_arrays[entry->layer >> LF_TEX_ARRAY_CLASS_SHIFT];
+  array->free_layers[array->free_count++] = entry->layer & ((1 << LF_TEX_ARRAY_CLASS_SHIFT) - 1);
+
+  // Backward shift deletion to keep the linear probing chains intact
+  const uint32_t mask = state.render.gl.tex_layer_cap - 1;
+  uint32_t i = (uint32_t)(entry - state.render.gl.tex_layers);
+  uint32_t j = i;
+  while(true) {
+    j = (j + 1) & mask;
+    if(!state.render.gl.tex_layers[j].id) break;
+    uint32_t home = (state.render.gl.tex_layers[j].id * 2654435761u) & mask;
+    if((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) continue;
+    state.render.gl.tex_layers[i] = state.render.gl.tex_layers[j];
+    i = j;
+  }
+  state.render.gl.tex_layers[i].id = 0;
+  state.render.gl.tex_layer_count--;
+}
+
+LfTextProps text_render_simple(vec2s pos, const char* text, LfFont font, LfColor font_color, bool no_render) {
+  return lf_text_render(pos, text, font, font_color, -1, (vec2s){-1, -1}, no_render, false, -1, -1);
+}
+LfTextProps text_render_simple_wide(vec2s pos, const wchar_t* text, LfFont font, LfColor font_color, bool no_render) {
+  return lf_text_render_wchar(pos, text, font, font_color, -1, (vec2s){-1, -1}, no_render, false, -1, -1);
+}
+
+
+LfClickableItemState button(const char* file, int32_t line, vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width,  bool click_color, bool hover_color) {
+  return button_ex(file, line, pos, size, props, color, border_width, click_color, hover_color, (vec2s){-1, -1}); 
+}
+LfClickableItemState button_ex(const char* file, int32_t line, vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width, bool click_color, bool hover_color, vec2s hitbox_override) {
+  uint64_t id = DJB2_INIT;
+  id = djb2_hash(id, file, strlen(file));
+  id = djb2_hash(id, &line, sizeof(line));
+  if(state.element_id_stack != -1) {
+    id = djb2_hash(id, &state.element_id_stack, sizeof(state.element_id_stack));
+  }
+
+  if(item_should_cull((LfAABB){.pos = pos, .size= size})) {
+    return LF_IDLE;
+  }
+
+  LfColor hover_color_rgb = hover_color ? (props.hover_color.a == 0.0f ? lf_color_brightness(color, 1.2) : props.hover_color) : color; 
+  LfColor held_color_rgb = click_color ? lf_color_brightness(color, 1.3) : color; 
+
+  bool is_hovered = lf_hovered(pos, (vec2s){hitbox_override.x != -1 ? hitbox_override.x : size.x,
+                                            hitbox_override.y != -1 ? hitbox_override.y : size.y});
+  if(state.active_element_id == 0) {
+    if(is_hovered && lf_mouse_button_went_down(GLFW_MOUSE_BUTTON_LEFT)) {
+      state.active_element_id = id;
+    }
+  } else if(state.active_element_id == id) {
+    if(is_hovered && lf_mouse_button_is_released(GLFW_MOUSE_BUTTON_LEFT)) {
+      lf_rect_render(pos, size, hover_color_rgb, props.border_color, border_width, props.corner_radius);
+      state.active_element_id = 0;
+      return LF_CLICKED;
+    }
+  }
+  if(is_hovered && lf_mouse_button_is_released(GLFW_MOUSE_BUTTON_LEFT)) {
+    state.active_element_id = 0;
+  }
+  if(is_hovered && lf_mouse_button_is_down(GLFW_MOUSE_BUTTON_LEFT)) {
+    lf_rect_render(pos, size, held_color_rgb, props.border_color, border_width, props.corner_radius);
+    return LF_HELD;
+  }
+  if(is_hovered && (!lf_mouse_button_went_down(GLFW_MOUSE_BUTTON_LEFT) && !lf_mouse_button_is_down(GLFW_MOUSE_BUTTON_LEFT))) {
+    lf_rect_render(pos, size, hover_color ? hover_color_rgb : color, props.border_color, border_width, props.corner_radius);
+    return LF_HOVERED;
+  }
+  lf_rect_render(pos, size, color, props.border_color, border_width, props.corner_radius);
+  return LF_IDLE;
+
+}
+LfClickableItemState div_container(vec2s pos, vec2s size, LfUIElementProps props, LfColor color, float border_width, bool click_color, bool hover_color) {
+  if(item_should_cull((LfAABB){.pos = pos, .size = size})) {
+    return LF_IDLE;
   }
 
   LfColor hover_color_rgb = hover_color ? (props.hover_color.a == 0.0f ? lf_color_brightness(color, 1.5) : props.hover_color) : color; 
@@ -697,6 +2660,17 @@ void next_line_on_overflow(vec2s size, float xoffset) {
   }
 }
 
+double get_time() {
+  // Monotonic time in seconds (used to measure the CPU time of a frame)
+  struct timespec ts;
+#ifdef _WIN32
+  timespec_get(&ts, TIME_UTC);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
 bool item_should_cull(LfAABB item) {
   bool intersect = true;
   LfAABB window =  (LfAABB){.pos = (vec2s){0, 0}, .size = (vec2s){state.dsp_w, state.dsp_h}};
@@ -793,15 +2767,16 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
   state.pos_ptr.y += props.margin_top; 
 
   float wrap_point = state.pos_ptr.x + input->width - props.padding;
+  // Same wrap width as lf_text_render() uses with wrap_point, so both share the cached layout
+  float wrap_width = (float)(int32_t)wrap_point - (state.pos_ptr.x + props.padding);
 
   if(input->selected) {
+    // Carets are placed by hit testing the laid out buffer instead of rendering up to the mouse
+    const LfTextLayout* layout = lf_text_layout(input->buf, &font, wrap_width);
+    float mouse_x = lf_get_mouse_x() - (state.pos_ptr.x + props.padding);
+    float mouse_y = lf_get_mouse_y() - (state.pos_ptr.y + props.padding);
     if(lf_mouse_button_went_down(GLFW_MOUSE_BUTTON_LEFT) && (lf_get_mouse_x_delta() == 0 && lf_get_mouse_y_delta() == 0)) {
-      LfTextProps selected_props = lf_text_render((vec2s){
-        state.pos_ptr.x + props.padding, 
-        state.pos_ptr.y + props.padding
-      }, input->buf, font, LF_NO_COLOR, 
-                                                  wrap_point, (vec2s){lf_get_mouse_x(), lf_get_mouse_y()}, true, false, -1, -1);
-      input->cursor_index = selected_props.rendered_count;
+      input->cursor_index = lf_text_hit_test(layout, mouse_x, mouse_y);
       lf_input_field_unselect_all(input);
       input->mouse_selection_end = input->cursor_index;
       input->mouse_selection_start = input->cursor_index;
@@ -811,12 +2786,7 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
         input->mouse_selection_end = input->cursor_index;
         input->mouse_selection_start = input->cursor_index;
       }
-      LfTextProps selected_props = lf_text_render((vec2s){
-        state.pos_ptr.x + props.padding, 
-        state.pos_ptr.y + props.padding
-      }, input->buf, font, LF_NO_COLOR, wrap_point, (vec2s){lf_get_mouse_x(), lf_get_mouse_y()}, true, false, -1, -1);
-
-      input->cursor_index = selected_props.rendered_count;
+      input->cursor_index = lf_text_hit_test(layout, mouse_x, mouse_y);
 
       if(input->mouse_dir == -1) 
         input->mouse_selection_start = input->cursor_index;
@@ -954,8 +2924,8 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
         }
         case GLFW_KEY_C: {
           if(!lf_key_is_down(GLFW_KEY_LEFT_CONTROL)) break;
-          char selection[strlen(input->buf)];
-          memset(selection, 0, strlen(input->buf));
+          char* selection = (char*)arena_alloc(strlen(input->buf) + 1);
+          memset(selection, 0, strlen(input->buf) + 1);
           substr_str(input->buf, input->selection_start, input->selection_end, selection);
 
           clipboard_set_text(state.clipboard, selection);
@@ -974,8 +2944,8 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
         }
         case GLFW_KEY_X: {
           if (!lf_key_is_down(GLFW_KEY_LEFT_CONTROL)) break;
-          char selection[strlen(input->buf)];
-          memset(selection, 0, strlen(input->buf));
+          char* selection = (char*)arena_alloc(strlen(input->buf) + 1);
+          memset(selection, 0, strlen(input->buf) + 1);
           substr_str(input->buf, input->selection_start, input->selection_end, selection);
 
           clipboard_set_text(state.clipboard, selection);
@@ -1024,27 +2994,16 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
   } else if(inputfield == LF_CLICKED) {
     input->selected = true;
     state.input_grabbed = true;
-    LfTextProps selected_props = lf_text_render((vec2s){
-      state.pos_ptr.x + props.padding, 
-      state.pos_ptr.y + props.padding
-    }, input->buf, font, LF_NO_COLOR, 
-      wrap_point, (vec2s){lf_get_mouse_x(), lf_get_mouse_y()}, true, false, -1, -1);
-    input->cursor_index = selected_props.rendered_count;
+    const LfTextLayout* layout = lf_text_layout(input->buf, &font, wrap_width);
+    input->cursor_index = lf_text_hit_test(layout, lf_get_mouse_x() - (state.pos_ptr.x + props.padding), 
+                                           lf_get_mouse_y() - (state.pos_ptr.y + props.padding));
   }
 
   if(input->selected) {
-    char selected_buf[strlen(input->buf)];
-    strncpy(selected_buf, input->buf, input->cursor_index);
-    selected_buf[input->cursor_index] = '\0';
-
-    LfTextProps selected_props =  lf_text_render((vec2s){state.pos_ptr.x + props.padding, lf_get_mouse_y() + props.padding}, selected_buf, 
-                                                 font, LF_NO_COLOR, wrap_point, (vec2s){-1, -1}, true, false, -1, -1);
-
-    vec2s cursor_pos = 
-      {
-        (strlen(input->buf) > 0) ? selected_props.end_x : state.pos_ptr.x + props.padding, 
-        state.pos_ptr.y + props.padding + (selected_props.height - get_max_char_height_font(font)) 
-      }; 
+    // The buffer may have been edited above, the layout is cached if it wasn't
+    const LfTextLayout* layout = lf_text_layout(input->buf, &font, wrap_width);
+    vec2s caret = lf_text_index_to_pos(layout, input->cursor_index);
+    vec2s cursor_pos = {state.pos_ptr.x + props.padding + caret.x, state.pos_ptr.y + props.padding + caret.y}; 
     if(input->selection_start == -1 || input->selection_end == -1) {
       lf_rect_render(cursor_pos, (vec2s){1, get_max_char_height_font(font)}, props.text_color, 
                      LF_NO_COLOR, 0.0f, 0.0f);
@@ -1065,69 +3024,650 @@ void input_field(LfInputField* input, InputFieldType type, const char* file, int
   state.pos_ptr.y -= props.margin_top;
 }
 
-LfFont load_font(const char* filepath, uint32_t pixelsize, uint32_t tex_width, uint32_t tex_height,  uint32_t line_gap_add) {
+LfFont load_font(const char* filepath, uint32_t pixelsize, uint32_t tex_width, uint32_t tex_height,  uint32_t line_gap_add, bool sdf) {
+  (void)tex_width; (void)tex_height;
+  FontFace* face = font_face_open(filepath);
+  if(!face) return (LfFont){0};
+  return font_create(face, pixelsize, line_gap_add, sdf);
+}
+
+LfFont font_create(FontFace* face, uint32_t pixelsize, uint32_t line_gap_add, bool sdf) {
+  // The atlas is released with the last face
+  if(!state.atlas.pixels) 
+    glyph_atlas_init();
+
   LfFont font = {0};
-  /* Opening the file, reading the content to a buffer and parsing the loaded data with stb_truetype */
+  font.face = face;
+  font.font_info = &face->info;
+  font.id = ++state.atlas.font_count;
+  font.num_glyphs = face->info.numGlyphs;
+  font.line_gap_add = line_gap_add;
+  font.font_size = pixelsize;
+  font.sdf = sdf;
+
+  // SDF fonts are rasterized at LF_SDF_SIZE whatever size they are drawn at
+  uint32_t raster_size = sdf ? LF_SDF_SIZE : pixelsize;
+  font.scale = stbtt_ScaleForPixelHeight(&face->info, raster_size);
+  font.render_scale = (float)pixelsize / raster_size;
+
+  // Glyphs are rasterized into the shared atlas when they are first drawn
+  font.bitmap = state.atlas.texture;
+  font.tex_width = state.atlas.width;
+  font.tex_height = state.atlas.height;
+  font.glyph_pages = (LfGlyph**)mem_calloc(LF_GLYPH_PAGE_COUNT, sizeof(LfGlyph*), LF_MEM_FONTS);
+  font.glyph_cache = glyph_cache_open(face->hash, raster_size, sdf);
+  font_set_metrics(&font);
+
+  // Text of fonts with one advance for all of printable ASCII is laid out by column
+  int32_t mono = -1;
+  for(uint32_t cp = ' '; cp <= '~' && mono != 0; cp++) {
+    int32_t advance, lsb;
+    stbtt_GetCodepointHMetrics(&face->info, cp, &advance, &lsb);
+    bool missing = cp != ' ' && !stbtt_FindGlyphIndex(&face->info, cp);
+    mono = (missing || (mono != -1 && advance != mono)) ? 0 : advance;
+  }
+  font.mono_advance = font.scale * mono;
+  return font;
+}
+
+FontFace* font_face_open(const char* filepath) {
+  // Sharing the face if the file is loaded already
+  for(uint32_t i = 0; i < state.face_count; i++) {
+    if(state.faces[i]->path && strcmp(state.faces[i]->path, filepath) == 0) {
+      state.faces[i]->refs++;
+      return state.faces[i];
+    }
+  }
+
+  FontFace face = {0};
+#ifdef _WIN32
   FILE* file = fopen(filepath, "rb");
   if (file == NULL) {
-    LF_ERROR("Failed to open font file '%s'\n", filepath);
+    LF_ERROR("Failed to open font file '%s'", filepath);
+    return NULL;
   }
-
-  // Loading the content
   fseek(file, 0, SEEK_END);
-  long fileSize = ftell(file);
+  long size = ftell(file);
   fseek(file, 0, SEEK_SET);
-  uint8_t* buffer = (uint8_t*)malloc(fileSize);
-  size_t bytesRead = fread(buffer, 1, fileSize, file);
+  uint8_t* data = size > 0 ? (uint8_t*)mem_alloc(size, LF_MEM_FONTS) : NULL;
+  size_t bytes_read = data ? fread(data, 1, size, file) : 0;
   fclose(file); 
-  if (bytesRead != fileSize) {
-    LF_ERROR("Failed to read font file '%s'\n", filepath);
-    // Handle the error (e.g., free memory and return from the function)
-    free(buffer);
-    LfFont emptyFont = {0}; // Or whatever initialization you need
-    return emptyFont;
-}
-  font.font_info = malloc(sizeof(stbtt_fontinfo));
-
-  // Initializing the font with stb_truetype
-  stbtt_InitFont((stbtt_fontinfo*)font.font_info, buffer, stbtt_GetFontOffsetForIndex(buffer, 0));
-
-  stbtt_fontinfo* fontinfo = (stbtt_fontinfo*)font.font_info;
-  int numglyphs = fontinfo->numGlyphs;
-
-  // Loading the font bitmap to memory by using stbtt_BakeFontBitmap
-  uint8_t* bitmap = (uint8_t*)malloc(tex_width * tex_height * sizeof(uint32_t));
-  uint8_t* bitmap_4bpp = (uint8_t*)malloc(tex_width * tex_height * 4 * sizeof(uint32_t));
-  font.cdata = malloc(sizeof(stbtt_bakedchar) * numglyphs);
-  font.tex_width = tex_width;
-  font.tex_height = tex_height;
-  font.line_gap_add = line_gap_add;
-  font.font_size = pixelsize;
-  font.num_glyphs = numglyphs;
-  stbtt_BakeFontBitmap(buffer, 0, pixelsize, bitmap, tex_width, tex_height, 32, numglyphs, (stbtt_bakedchar*)font.cdata);
-
-  uint32_t bitmap_index = 0;
-  for(uint32_t i = 0; i < (uint32_t)(tex_width * tex_height * 4); i++) {
-    bitmap_4bpp[i] = bitmap[bitmap_index];
-    if((i + 1) % 4 == 0) {
-      bitmap_index++;
-    }
-  }
-
-  // Creating an opengl texture (texture atlas) for the font
-  glGenTextures(1, &font.bitmap.id);
-  glBindTexture(GL_TEXTURE_2D, font.bitmap.id);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tex_width, tex_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, bitmap_4bpp);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  // Deallocating the bitmap data 
-  free(bitmap);
-  free(bitmap_4bpp);
-  return font;
+  if (!data || bytes_read != (size_t)size) {
+    LF_ERROR("Failed to read font file '%s'", filepath);
+    mem_free(data);
+    return NULL;
+  }
+  face.owned = true;
+#else
+  // Mapping the file, pages are only read in as stb_truetype touches them
+  int32_t fd = open(filepath, O_RDONLY);
+  if (fd == -1) {
+    LF_ERROR("Failed to open font file '%s'", filepath);
+    return NULL;
+  }
+  struct stat st;
+  uint8_t* data = NULL;
+  if(fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = (uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) data = NULL;
+  }
+  close(fd);
+  if (!data) {
+    LF_ERROR("Failed to map font file '%s'", filepath);
+    return NULL;
+  }
+  size_t size = st.st_size;
+  face.mapped = true;
+#endif
+  face.data = data;
+  face.size = size;
+  face.path = (char*)mem_alloc(strlen(filepath) + 1, LF_MEM_FONTS);
+  strcpy(face.path, filepath);
+  return font_face_add(&face);
+}
+
+FontFace* font_face_from_memory(const void* data, size_t size) {
+  for(uint32_t i = 0; i < state.face_count; i++) {
+    if(!state.faces[i]->path && state.faces[i]->data == data) {
+      state.faces[i]->refs++;
+      return state.faces[i];
+    }
+  }
+  FontFace face = {0};
+  face.data = (const uint8_t*)data;
+  face.size = size;
+  return font_face_add(&face);
+}
+
+FontFace* font_face_add(FontFace* face) {
+  int32_t offset = stbtt_GetFontOffsetForIndex(face->data, 0);
+  if(offset < 0 || !stbtt_InitFont(&face->info, face->data, offset)) {
+    LF_ERROR("Failed to parse font file '%s'", face->path ? face->path : "(memory)");
+    font_face_unload(face);
+    return NULL;
+  }
+  if(!state.config.disable_glyph_cache) {
+    // Keying the glyph cache on the size & the table directory instead of the whole file, 
+    // so a mapped file isn't paged in completely. The directory holds a checksum of every 
+    // table, the head table holds the one of the whole file.
+    face->hash = djb2_hash(DJB2_INIT, &face->size, sizeof(face->size));
+    size_t dir_size = 12 + 16 * (size_t)((face->data[offset + 4] << 8) | face->data[offset + 5]);
+    if((size_t)offset + dir_size <= face->size)
+      face->hash = djb2_hash(face->hash, face->data + offset, dir_size);
+    if(face->info.head && (size_t)face->info.head + 54 <= face->size)
+      face->hash = djb2_hash(face->hash, face->data + face->info.head, 54);
+  }
+  face->refs = 1;
+
+  if(state.face_count >= state.face_cap) {
+    state.face_cap = state.face_cap ? state.face_cap * 2 : 8;
+    state.faces = (FontFace**)mem_realloc(state.faces, sizeof(FontFace*) * state.face_cap, LF_MEM_FONTS);
+  }
+  // Faces are kept by pointer, the fonts point into them
+  FontFace* ret = (FontFace*)mem_alloc(sizeof(FontFace), LF_MEM_FONTS);
+  *ret = *face;
+  state.faces[state.face_count++] = ret;
+  return ret;
+}
+
+void font_face_unload(FontFace* face) {
+#ifndef _WIN32
+  if(face->mapped) 
+    munmap((void*)face->data, face->size);
+#endif
+  if(face->owned) 
+    mem_free((void*)face->data);
+  mem_free(face->path);
+}
+
+void font_face_release(FontFace* face) {
+  if(!face || --face->refs) return;
+  font_face_unload(face);
+
+  for(uint32_t i = 0; i < state.face_count; i++) {
+    if(state.faces[i] == face) {
+      state.faces[i] = state.faces[--state.face_count];
+      break;
+    }
+  }
+  mem_free(face);
+
+  // Releasing the glyph atlas with the last face, it is created again by the next font
+  if(!state.face_count) {
+    glyph_atlas_free();
+    mem_free(state.faces);
+    state.faces = NULL;
+    state.face_cap = 0;
+  }
+}
+
+void font_set_metrics(LfFont* font) {
+  // Caching the vertical metrics at the size the font is drawn at
+  const stbtt_fontinfo* fontinfo = (const stbtt_fontinfo*)font->font_info;
+  float scale = stbtt_ScaleForPixelHeight(fontinfo, font->font_size);
+  int32_t xmin, ymin, xmax, ymax;
+  stbtt_GetCodepointBitmapBox(fontinfo, 'p', scale, scale, &xmin, &ymin, &xmax, &ymax);
+  font->max_char_height = (float)(ymax - ymin);
+  int32_t ascent, descent, line_gap;
+  stbtt_GetFontVMetrics(fontinfo, &ascent, &descent, &line_gap);
+  font->ascent = ascent * scale;
+  font->descent = descent * scale;
+  font->line_gap = line_gap * scale;
+}
+
+LfGlyph* font_glyph(const LfFont* font, uint32_t cp) {
+  if(cp >= LF_GLYPH_PAGE_COUNT * LF_GLYPH_PAGE_SIZE || !font->glyph_pages) return NULL;
+  LfGlyph* page = font->glyph_pages[cp / LF_GLYPH_PAGE_SIZE];
+  LfGlyph* glyph = (page && page[cp % LF_GLYPH_PAGE_SIZE].loaded) ? &page[cp % LF_GLYPH_PAGE_SIZE] : font_load_glyph(font, cp);
+  return glyph->present ? glyph : NULL;
+}
+
+LfGlyph* font_load_glyph(const LfFont* font, uint32_t cp) {
+  LfGlyph** page = &font->glyph_pages[cp / LF_GLYPH_PAGE_SIZE];
+  if(!*page) 
+    *page = (LfGlyph*)mem_calloc(LF_GLYPH_PAGE_SIZE, sizeof(LfGlyph), LF_MEM_FONTS);
+  LfGlyph* glyph = &(*page)[cp % LF_GLYPH_PAGE_SIZE];
+  glyph->loaded = true;
+  glyph->codepoint = cp;
+
+  // Control characters have no glyph
+  if(cp < 32) return glyph;
+
+  GlyphCache* cache = (GlyphCache*)font->glyph_cache;
+  const GlyphCacheRecord* record = glyph_cache_find(cache, cp);
+  if(record) {
+    glyph->xoff = record->xoff;
+    glyph->yoff = record->yoff;
+    glyph->width = record->width;
+    glyph->height = record->height;
+    glyph->advance = record->advance;
+    glyph->present = record->present != 0;
+    return glyph;
+  }
+  if(cache) cache->dirty = true;
+
+  // Missing glyphs are skipped instead of drawing .notdef
+  const stbtt_fontinfo* fontinfo = (const stbtt_fontinfo*)font->font_info;
+  int32_t index = stbtt_FindGlyphIndex(fontinfo, cp);
+  if(!index && cp != ' ') return glyph;
+
+  // Same metrics as stbtt_BakeFontBitmap()
+  int32_t advance, lsb, x0, y0, x1, y1;
+  stbtt_GetGlyphHMetrics(fontinfo, index, &advance, &lsb);
+  stbtt_GetGlyphBitmapBox(fontinfo, index, font->scale, font->scale, &x0, &y0, &x1, &y1);
+  if(font->sdf && x1 > x0 && y1 > y0) {
+    // Same box as stbtt_GetGlyphSDF()
+    x0 -= LF_SDF_PADDING;
+    y0 -= LF_SDF_PADDING;
+    x1 += LF_SDF_PADDING;
+    y1 += LF_SDF_PADDING;
+  }
+  glyph->xoff = (float)x0;
+  glyph->yoff = (float)y0;
+  glyph->width = (float)(x1 - x0);
+  glyph->height = (float)(y1 - y0);
+  glyph->advance = font->scale * advance;
+  glyph->present = true;
+  return glyph;
+}
+
+void glyph_atlas_init() {
+  GlyphAtlas* atlas = &state.atlas;
+  atlas->width = state.config.font_atlas_width;
+  atlas->height = state.config.font_atlas_height;
+  atlas->pixels = (uint8_t*)mem_calloc((size_t)atlas->width * atlas->height, 1, LF_MEM_FONTS);
+  atlas->dirty_y0 = atlas->height;
+  atlas->dirty_y1 = 0;
+  atlas->texture.width = atlas->width;
+  atlas->texture.height = atlas->height;
+  renderer_create_texture(&atlas->texture, NULL, 1, LF_TEX_FILTER_LINEAR, true);
+}
+
+void glyph_atlas_free() {
+  GlyphAtlas* atlas = &state.atlas;
+  if(atlas->texture.id && state.render.backend.delete_texture) 
+    state.render.backend.delete_texture(state.render.backend.user_data, &atlas->texture);
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) 
+    mem_free(atlas->shelves[i].slots);
+  mem_free(atlas->shelves);
+  mem_free(atlas->pixels);
+  uint32_t font_count = atlas->font_count;
+  memset(atlas, 0, sizeof(*atlas));
+  atlas->font_count = font_count;
+}
+
+void glyph_atlas_clear() {
+  GlyphAtlas* atlas = &state.atlas;
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) {
+    glyph_atlas_evict_shelf(&atlas->shelves[i]);
+    mem_free(atlas->shelves[i].slots);
+  }
+  atlas->shelf_count = 0;
+  atlas->next_y = 0;
+  atlas->full = false;
+}
+
+void glyph_atlas_evict_shelf(AtlasShelf* shelf) {
+  for(uint32_t i = 0; i < shelf->slot_count; i++) {
+    if(shelf->slots[i].glyph) 
+      shelf->slots[i].glyph->shelf = 0;
+  }
+  shelf->slot_count = 0;
+  shelf->x = 0;
+  state.atlas.generation++;
+  state.render.stats.atlas_evictions++;
+}
+
+int32_t glyph_atlas_alloc_shelf(uint32_t w, uint32_t h) {
+  GlyphAtlas* atlas = &state.atlas;
+  if(w > atlas->width || h > atlas->height) return -1;
+
+  // Best fitting shelf that still has room, shelves may be up to a quarter taller than the glyph
+  int32_t best = -1;
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) {
+    AtlasShelf* shelf = &atlas->shelves[i];
+    if(shelf->height < h || shelf->height > h + h / 4 + 2 || shelf->x + w > atlas->width) continue;
+    if(best == -1 || shelf->height < atlas->shelves[best].height) best = i;
+  }
+  if(best != -1) return best;
+
+  // Opening a new shelf
+  if(atlas->next_y + h <= atlas->height) {
+    if(atlas->shelf_count >= atlas->shelf_cap) {
+      atlas->shelf_cap = atlas->shelf_cap ? atlas->shelf_cap * 2 : 32;
+      atlas->shelves = (AtlasShelf*)mem_realloc(atlas->shelves, sizeof(AtlasShelf) * atlas->shelf_cap, LF_MEM_FONTS);
+    }
+    atlas->shelves[atlas->shelf_count] = (AtlasShelf){.y = atlas->next_y, .height = h};
+    atlas->next_y += h;
+    return atlas->shelf_count++;
+  }
+
+  // Evicting the least recently used shelf that is tall enough & not drawn from this frame
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) {
+    AtlasShelf* shelf = &atlas->shelves[i];
+    if(shelf->height < h || shelf->last_used >= atlas->frame) continue;
+    if(best == -1 || shelf->last_used < atlas->shelves[best].last_used || 
+      (shelf->last_used == atlas->shelves[best].last_used && shelf->height < atlas->shelves[best].height)) 
+      best = i;
+  }
+  if(best != -1) {
+    glyph_atlas_evict_shelf(&atlas->shelves[best]);
+    return best;
+  }
+
+  // Merging the least recently used run of neighbouring stale shelves into one that is tall enough
+  uint32_t run_end = 0;
+  uint64_t run_used = 0;
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) {
+    uint32_t height = 0, j = i;
+    uint64_t used = 0;
+    for(; j < atlas->shelf_count && height < h && atlas->shelves[j].last_used < atlas->frame; j++) {
+      height += atlas->shelves[j].height;
+      if(atlas->shelves[j].last_used > used) used = atlas->shelves[j].last_used;
+    }
+    if(j == atlas->shelf_count) 
+      height += atlas->height - atlas->next_y;
+    if(height < h || j == i) continue;
+    if(best == -1 || used < run_used) {
+      best = i;
+      run_end = j;
+      run_used = used;
+    }
+  }
+  if(best == -1) return -1;
+
+  for(uint32_t i = best; i < run_end; i++) {
+    glyph_atlas_evict_shelf(&atlas->shelves[i]);
+    if(i != (uint32_t)best) mem_free(atlas->shelves[i].slots);
+  }
+  if(run_end == atlas->shelf_count) {
+    // The run reaches the free space, so it becomes a new shelf
+    mem_free(atlas->shelves[best].slots);
+    atlas->next_y = atlas->shelves[best].y;
+    atlas->shelf_count = best;
+    return glyph_atlas_alloc_shelf(w, h);
+  }
+  AtlasShelf* shelf = &atlas->shelves[best];
+  shelf->height = atlas->shelves[run_end].y - shelf->y;
+  memmove(&atlas->shelves[best + 1], &atlas->shelves[run_end], sizeof(AtlasShelf) * (atlas->shelf_count - run_end));
+  atlas->shelf_count -= run_end - best - 1;
+
+  // Glyphs refer to their shelf by index
+  for(uint32_t i = best + 1; i < atlas->shelf_count; i++) {
+    for(uint32_t j = 0; j < atlas->shelves[i].slot_count; j++) {
+      if(atlas->shelves[i].slots[j].glyph) 
+        atlas->shelves[i].slots[j].glyph->shelf = i + 1;
+    }
+  }
+  return best;
+}
+
+bool glyph_atlas_ensure(const LfFont* font, LfGlyph* glyph) {
+  GlyphAtlas* atlas = &state.atlas;
+  if(glyph->shelf) {
+    atlas->shelves[glyph->shelf - 1].last_used = atlas->frame;
+    return true;
+  }
+  // Blank glyphs (spaces) have nothing to rasterize
+  if(glyph->width <= 0.0f || glyph->height <= 0.0f) return true;
+  if(!atlas->pixels) return false;
+
+  uint32_t w = (uint32_t)glyph->width, h = (uint32_t)glyph->height;
+  int32_t index = glyph_atlas_alloc_shelf(w + LF_GLYPH_ATLAS_PADDING, h + LF_GLYPH_ATLAS_PADDING);
+  if(index == -1) {
+    if(w + LF_GLYPH_ATLAS_PADDING > atlas->width || h + LF_GLYPH_ATLAS_PADDING > atlas->height) {
+      LF_ERROR("Glyph U+%04X does not fit into the glyph atlas, increase LfConfig.font_atlas_width/height.", glyph->codepoint);
+    } else if(!atlas->full) {
+      // Too fragmented or too many glyphs in one frame, packing from scratch at the next frame
+      atlas->full = true;
+    }
+    return false;
+  }
+  AtlasShelf* shelf = &atlas->shelves[index];
+  uint32_t x = shelf->x, y = shelf->y;
+
+  // Clearing what an evicted glyph left behind & rasterizing
+  for(uint32_t row = 0; row < h + LF_GLYPH_ATLAS_PADDING && y + row < atlas->height; row++) 
+    memset(atlas->pixels + (size_t)(y + row) * atlas->width + x, 0, MIN(w + LF_GLYPH_ATLAS_PADDING, atlas->width - x));
+  glyph_rasterize(font, glyph, atlas->pixels + (size_t)y * atlas->width + x, atlas->width);
+
+  if(shelf->slot_count >= shelf->slot_cap) {
+    shelf->slot_cap = shelf->slot_cap ? shelf->slot_cap * 2 : 32;
+    shelf->slots = (AtlasSlot*)mem_realloc(shelf->slots, sizeof(AtlasSlot) * shelf->slot_cap, LF_MEM_FONTS);
+  }
+  shelf->slots[shelf->slot_count++] = (AtlasSlot){.glyph = glyph, .font_id = font->id};
+  shelf->x += w + LF_GLYPH_ATLAS_PADDING;
+  shelf->last_used = atlas->frame;
+
+  glyph->shelf = index + 1;
+  glyph->s0 = x / (float)atlas->width;
+  glyph->t0 = y / (float)atlas->height;
+  glyph->s1 = (x + w) / (float)atlas->width;
+  glyph->t1 = (y + h) / (float)atlas->height;
+
+  if(y < atlas->dirty_y0) atlas->dirty_y0 = y;
+  // The padding row is sampled by bilinear filtering as well
+  uint32_t y1 = y + h + LF_GLYPH_ATLAS_PADDING < atlas->height ? y + h + LF_GLYPH_ATLAS_PADDING : atlas->height;
+  if(y1 > atlas->dirty_y1) atlas->dirty_y1 = y1;
+  return true;
+}
+
+void glyph_atlas_upload() {
+  // Uploading all rows that changed during the frame at once
+  GlyphAtlas* atlas = &state.atlas;
+  if(atlas->dirty_y0 >= atlas->dirty_y1) return;
+  uint32_t y = atlas->dirty_y0, h = atlas->dirty_y1 - atlas->dirty_y0;
+  atlas->dirty_y0 = atlas->height;
+  atlas->dirty_y1 = 0;
+  if(!state.render.backend.update_texture) return;
+
+  state.render.backend.update_texture(state.render.backend.user_data, &atlas->texture, 0, y, atlas->width, h, 
+                                      atlas->pixels + (size_t)y * atlas->width, 1);
+  state.render.stats.atlas_upload_bytes += (size_t)atlas->width * h;
+}
+
+void glyph_atlas_purge_font(uint32_t font_id) {
+  // The slots of a freed font are kept as holes until their shelf is evicted
+  GlyphAtlas* atlas = &state.atlas;
+  for(uint32_t i = 0; i < atlas->shelf_count; i++) {
+    AtlasShelf* shelf = &atlas->shelves[i];
+    for(uint32_t j = 0; j < shelf->slot_count; j++) {
+      if(shelf->slots[j].font_id == font_id) 
+        shelf->slots[j].glyph = NULL;
+    }
+  }
+}
+
+void glyph_rasterize(const LfFont* font, const LfGlyph* glyph, uint8_t* dst, uint32_t stride) {
+  uint32_t w = (uint32_t)glyph->width, h = (uint32_t)glyph->height;
+  const GlyphCache* cache = (const GlyphCache*)font->glyph_cache;
+  const GlyphCacheRecord* record = glyph_cache_find(cache, glyph->codepoint);
+  if(record && record->width == w && record->height == h && (size_t)record->offset + (size_t)w * h <= cache->size) {
+    for(uint32_t row = 0; row < h; row++) 
+      memcpy(dst + (size_t)row * stride, cache->data + record->offset + (size_t)row * w, w);
+    return;
+  }
+  state.render.stats.glyphs_rasterized++;
+  if(!font->sdf) {
+    stbtt_MakeCodepointBitmap((const stbtt_fontinfo*)font->font_info, dst, w, h, stride, font->scale, font->scale, glyph->codepoint);
+    return;
+  }
+  int32_t sdf_w, sdf_h, xoff, yoff;
+  uint8_t* sdf = stbtt_GetCodepointSDF((const stbtt_fontinfo*)font->font_info, font->scale, glyph->codepoint, 
+                                       LF_SDF_PADDING, LF_SDF_ONEDGE, (float)LF_SDF_ONEDGE / LF_SDF_PADDING, 
+                                       &sdf_w, &sdf_h, &xoff, &yoff);
+  if(!sdf) return;
+  for(uint32_t row = 0; row < h && row < (uint32_t)sdf_h; row++) 
+    memcpy(dst + (size_t)row * stride, sdf + (size_t)row * sdf_w, MIN(w, (uint32_t)sdf_w));
+  stbtt_FreeSDF(sdf, NULL);
+}
+
+bool glyph_cache_path(char* path, size_t size, const GlyphCache* cache) {
+  const char* home = getenv(HOMEDIR);
+  if(!home) return false;
+  int32_t len = snprintf(path, size, "%s/.leif/cache/%016llx-%u%s.lfgc", home, (unsigned long long)cache->font_hash, 
+                         cache->font_size, cache->sdf ? "-sdf" : "");
+  return len > 0 && (size_t)len < size;
+}
+
+GlyphCache* glyph_cache_open(uint64_t font_hash, uint32_t font_size, bool sdf) {
+  if(state.config.disable_glyph_cache) return NULL;
+  GlyphCache* cache = (GlyphCache*)mem_calloc(1, sizeof(GlyphCache), LF_MEM_FONTS);
+  cache->font_hash = font_hash;
+  cache->font_size = font_size;
+  cache->sdf = sdf;
+
+  char path[1024];
+  if(!glyph_cache_path(path, sizeof(path), cache)) return cache;
+
+  // Mapping the glyphs of an earlier run
+#ifdef _WIN32
+  FILE* file = fopen(path, "rb");
+  if(!file) return cache;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* data = size > 0 ? (uint8_t*)mem_alloc(size, LF_MEM_FONTS) : NULL;
+  if(data && fread(data, 1, size, file) != (size_t)size) {
+    mem_free(data);
+    data = NULL;
+  }
+  fclose(file);
+  if(!data) return cache;
+#else
+  int32_t fd = open(path, O_RDONLY);
+  if(fd == -1) return cache;
+  struct stat st;
+  uint8_t* data = NULL;
+  if(fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = (uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) data = NULL;
+  }
+  close(fd);
+  if(!data) return cache;
+  size_t size = st.st_size;
+#endif
+  cache->data = data;
+  cache->size = size;
+
+  // Ignoring files of another version, font or size
+  const GlyphCacheHeader* header = (const GlyphCacheHeader*)data;
+  if(cache->size < sizeof(GlyphCacheHeader) || memcmp(header->magic, "LFGC", 4) != 0 || 
+    header->version != LF_GLYPH_CACHE_VERSION || header->font_hash != cache->font_hash || header->font_size != font_size ||
+    (size_t)header->record_count * sizeof(GlyphCacheRecord) > cache->size - sizeof(GlyphCacheHeader)) 
+    return cache;
+  cache->records = (const GlyphCacheRecord*)(data + sizeof(GlyphCacheHeader));
+  cache->record_count = header->record_count;
+  return cache;
+}
+
+const GlyphCacheRecord* glyph_cache_find(const GlyphCache* cache, uint32_t cp) {
+  if(!cache || !cache->record_count) return NULL;
+  uint32_t lo = 0, hi = cache->record_count;
+  while(lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if(cache->records[mid].codepoint < cp) lo = mid + 1;
+    else hi = mid;
+  }
+  return (lo < cache->record_count && cache->records[lo].codepoint == cp) ? &cache->records[lo] : NULL;
+}
+
+void glyph_cache_save(const LfFont* font) {
+  const GlyphCache* cache = (const GlyphCache*)font->glyph_cache;
+  if(!cache || !cache->dirty) return;
+
+  // Counting the loaded glyphs (pages are in code point order)
+  uint32_t count = 0;
+  size_t pixel_bytes = 0;
+  for(uint32_t p = 0; p < LF_GLYPH_PAGE_COUNT; p++) {
+    if(!font->glyph_pages[p]) continue;
+    for(uint32_t i = 0; i < LF_GLYPH_PAGE_SIZE; i++) {
+      const LfGlyph* glyph = &font->glyph_pages[p][i];
+      if(!glyph->loaded || glyph->codepoint < 32) continue;
+      count++;
+      if(glyph->present) pixel_bytes += (size_t)glyph->width * glyph->height;
+    }
+  }
+
+  size_t size = sizeof(GlyphCacheHeader) + sizeof(GlyphCacheRecord) * count + pixel_bytes;
+  uint8_t* data = (uint8_t*)mem_alloc(size, LF_MEM_FONTS);
+  GlyphCacheHeader* header = (GlyphCacheHeader*)data;
+  *header = (GlyphCacheHeader){.version = LF_GLYPH_CACHE_VERSION, .font_hash = cache->font_hash, 
+    .font_size = cache->font_size, .record_count = count};
+  memcpy(header->magic, "LFGC", 4);
+  GlyphCacheRecord* records = (GlyphCacheRecord*)(data + sizeof(GlyphCacheHeader));
+  uint32_t offset = sizeof(GlyphCacheHeader) + sizeof(GlyphCacheRecord) * count;
+  uint32_t r = 0;
+  for(uint32_t p = 0; p < LF_GLYPH_PAGE_COUNT; p++) {
+    if(!font->glyph_pages[p]) continue;
+    for(uint32_t i = 0; i < LF_GLYPH_PAGE_SIZE; i++) {
+      const LfGlyph* glyph = &font->glyph_pages[p][i];
+      if(!glyph->loaded || glyph->codepoint < 32) continue;
+      uint32_t w = glyph->present ? (uint32_t)glyph->width : 0, h = glyph->present ? (uint32_t)glyph->height : 0;
+      records[r++] = (GlyphCacheRecord){
+        .codepoint = glyph->codepoint, .xoff = (int16_t)glyph->xoff, .yoff = (int16_t)glyph->yoff, 
+        .width = w, .height = h, .advance = glyph->advance, .present = glyph->present, .offset = offset
+      };
+      if(!w || !h) continue;
+
+      // Copying the coverage out of the atlas if the glyph is still in there
+      if(glyph->shelf) {
+        const GlyphAtlas* atlas = &state.atlas;
+        uint32_t x = (uint32_t)(glyph->s0 * atlas->width + 0.5f), y = (uint32_t)(glyph->t0 * atlas->height + 0.5f);
+        for(uint32_t row = 0; row < h; row++) 
+          memcpy(data + offset + (size_t)row * w, atlas->pixels + (size_t)(y + row) * atlas->width + x, w);
+      } else {
+        glyph_rasterize(font, glyph, data + offset, w);
+      }
+      offset += w * h;
+    }
+  }
+
+  // Writing to a temporary file first so other processes never map a partial file
+  char path[1024], tmp_path[1040];
+  if(glyph_cache_path(path, sizeof(path), cache)) {
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s/.leif", getenv(HOMEDIR));
+#ifdef _WIN32
+    _mkdir(dir);
+    strcat(dir, "/cache");
+    _mkdir(dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+#else
+    mkdir(dir, 0755);
+    strcat(dir, "/cache");
+    mkdir(dir, 0755);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%i", path, (int32_t)getpid());
+#endif
+    FILE* file = fopen(tmp_path, "wb");
+    if(file) {
+      bool written = fwrite(data, 1, size, file) == size;
+      written = fclose(file) == 0 && written;
+#ifdef _WIN32
+      if(written) remove(path);
+#endif
+      if(!written || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        LF_WARN("Failed to write the glyph cache '%s'.", path);
+      }
+    }
+  }
+  mem_free(data);
+}
+
+void glyph_cache_close(LfFont* font) {
+  GlyphCache* cache = (GlyphCache*)font->glyph_cache;
+  if(!cache) return;
+  glyph_cache_save(font);
+  if(cache->data) {
+#ifdef _WIN32
+    mem_free(cache->data);
+#else
+    munmap(cache->data, cache->size);
+#endif
+  }
+  mem_free(cache);
+  font->glyph_cache = NULL;
 }
 
 LfFont get_current_font() {
@@ -1213,7 +3753,10 @@ LfClickableItemState button_fixed_element_loc(void* text, float width, float hei
 
   // Rendering the text of the button
 
-  lf_set_cull_end_x(state.pos_ptr.x + render_width + padding);
+  // Clipping the text at the right side of the button
+  clip_stack_push();
+  float clip_end_x = state.pos_ptr.x + render_width + padding;
+  state.cull_end.x = state.cull_end.x == -1 ? clip_end_x : fminf(state.cull_end.x, clip_end_x);
   if(wide) {
     text_render_simple_wide((vec2s)
       {state.pos_ptr.x + padding + ((width != -1) ? (width - text_props.width) / 2.0f : 0),
@@ -1223,7 +3766,7 @@ LfClickableItemState button_fixed_element_loc(void* text, float width, float hei
       {state.pos_ptr.x + padding + ((width != -1) ? (width - text_props.width) / 2.0f : 0),
         state.pos_ptr.y + padding + ((height != -1) ? (height - text_props.height) / 2.0f : 0)}, (const char*)text, font, text_color, false);
   }
-  lf_unset_cull_end_x();
+  clip_stack_pop();
 
   // Advancing the position pointer by the width of the button
   state.pos_ptr.x += render_width + margin_right + padding * 2.0f;
@@ -1382,7 +3925,7 @@ int32_t menu_item_list_item_loc(void** items, uint32_t item_count, int32_t selec
   LfColor color = props.color;
   LfFont font = get_current_font();
 
-  LfTextProps text_props[item_count];
+  LfTextProps* text_props = (LfTextProps*)arena_alloc(sizeof(LfTextProps) * item_count);
   float width = 0;
   for(uint32_t i  = 0; i < item_count; i++) {
     if(wide)
@@ -1432,11 +3975,7 @@ int32_t menu_item_list_item_loc(void** items, uint32_t item_count, int32_t selec
 }
 
 static int32_t get_max_char_height_font(LfFont font) {
-  float fontScale = stbtt_ScaleForPixelHeight((stbtt_fontinfo*)font.font_info, font.font_size);
-  int32_t xmin, ymin, xmax, ymax;
-  int32_t codepoint = 'p';
-  stbtt_GetCodepointBitmapBox((stbtt_fontinfo*)font.font_info, codepoint, fontScale, fontScale, &xmin, &ymin, &xmax, &ymax);
-  return ymax - ymin;
+  return (int32_t)font.max_char_height;
 }
 void remove_i_str(char *str, int32_t index) {
   int32_t len = strlen(str);
@@ -1631,27 +4170,25 @@ void clear_events() {
 }
 
 uint64_t djb2_hash(uint64_t hash, const void* buf, size_t size) {
-  uint8_t* bytes = (uint8_t*)buf;
-  int c;
-
-  while ((c = *bytes++)) {
-    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+  const uint8_t* bytes = (const uint8_t*)buf;
+  for(size_t i = 0; i < size; i++) {
+    hash = ((hash << 5) + hash) + bytes[i]; /* hash * 33 + c */
   }
 
   return hash;
 }
 
 void props_stack_create(PropsStack* stack) {
-  stack->data = (LfUIElementProps*)malloc(LF_STACK_INIT_CAP * sizeof(LfUIElementProps));
+  stack->data = (LfUIElementProps*)mem_alloc(state.config.stack_capacity * sizeof(LfUIElementProps), LF_MEM_GENERAL);
   if(!stack->data) {
     LF_ERROR("Failed to allocate memory for stack data structure.\n");
   }
   stack->count = 0;
-  stack->cap = LF_STACK_INIT_CAP;
+  stack->cap = state.config.stack_capacity;
 }
 
 void props_stack_resize(PropsStack* stack, uint32_t newcap) {
-  LfUIElementProps* newdata = (LfUIElementProps*)realloc(stack->data, newcap * sizeof(LfUIElementProps));
+  LfUIElementProps* newdata = (LfUIElementProps*)mem_realloc(stack->data, newcap * sizeof(LfUIElementProps), LF_MEM_GENERAL);
   if(!newdata) {
     LF_ERROR("Failed to reallocate memory for stack datastructure.");
   }
@@ -1684,45 +4221,84 @@ bool props_stack_empty(PropsStack* stack) {
   return stack->count == 0;
 }
 
-LfUIElementProps get_props_for(LfUIElementProps props) {
-  return (!props_stack_empty(&state.props_stack)) ? props_stack_peak(&state.props_stack) : props; 
+void clip_stack_push() {
+  if(state.clip_stack_count == state.clip_stack_cap) {
+    state.clip_stack_cap = state.clip_stack_cap ? state.clip_stack_cap * 2 : state.config.stack_capacity;
+    state.clip_stack = (ClipRect*)mem_realloc(state.clip_stack, state.clip_stack_cap * sizeof(ClipRect), LF_MEM_GENERAL);
+  }
+  state.clip_stack[state.clip_stack_count++] = (ClipRect){.start = state.cull_start, .end = state.cull_end};
 }
 
-// ===========================================================
-// ----------------Public API Functions ---------------------- 
-// ===========================================================
-void lf_init_glfw(uint32_t display_width, uint32_t display_height, void* glfw_window) {
-  setlocale(LC_ALL, "");
-#ifndef LF_GLFW
-  LF_ERROR("Trying to initialize Leif with GLFW without defining 'LF_GLFW'");
-  return;
-#else 
-  if(!glfwInit()) {
-    LF_ERROR("Trying to initialize Leif with GLFW without initializing GLFW first.");
+void clip_stack_pop() {
+  LF_ASSERT(state.clip_stack_count != 0, "Stack underflow on the clip stack!");
+  if(!state.clip_stack_count) {
+    state.cull_start = (vec2s){-1, -1};
+    state.cull_end = (vec2s){-1, -1};
     return;
   }
+  ClipRect rect = state.clip_stack[--state.clip_stack_count];
+  state.cull_start = rect.start;
+  state.cull_end = rect.end;
+}
 
-  if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-    LF_ERROR("Failed to initialize Glad.");
-    return;
-  }
+LfUIElementProps get_props_for(LfUIElementProps props) {
+  return (!props_stack_empty(&state.props_stack)) ? props_stack_peak(&state.props_stack) : props; 
+}
+
+void init_state(const LfConfig* config) {
   memset(&state, 0, sizeof(state));
 
+  // Filling in the defaults of the configuration
+  state.config = *config;
+  LfConfig* cfg = &state.config;
+  if(!cfg->batch_capacity) cfg->batch_capacity = MAX_RENDER_BATCH;
+  if(!cfg->tex_slots || cfg->tex_slots > LF_MAX_TEX_SLOTS) cfg->tex_slots = MAX_TEX_COUNT_BATCH;
+  if(!cfg->stack_capacity) cfg->stack_capacity = LF_STACK_INIT_CAP;
+  if(!cfg->font_atlas_width) cfg->font_atlas_width = LF_FONT_ATLAS_SIZE;
+  if(!cfg->font_atlas_height) cfg->font_atlas_height = LF_FONT_ATLAS_SIZE;
+  if(!cfg->frame_arena_size) cfg->frame_arena_size = LF_FRAME_ARENA_SIZE;
+  if(!cfg->text_cache_capacity) cfg->text_cache_capacity = LF_TEXT_CACHE_SIZE;
+  if(!cfg->key_callbacks) cfg->key_callbacks = MAX_KEY_CALLBACKS;
+  if(!cfg->mouse_button_callbacks) cfg->mouse_button_callbacks = MAX_MOUSE_BTTUON_CALLBACKS;
+  if(!cfg->scroll_callbacks) cfg->scroll_callbacks = MAX_SCROLL_CALLBACKS;
+  if(!cfg->cursor_pos_callbacks) cfg->cursor_pos_callbacks = MAX_CURSOR_POS_CALLBACKS;
+
+  state.input.key_cbs = (KEY_CALLBACK_t*)mem_alloc(sizeof(KEY_CALLBACK_t) * cfg->key_callbacks, LF_MEM_GENERAL);
+  state.input.mouse_button_cbs = (MOUSE_BUTTON_CALLBACK_t*)mem_alloc(sizeof(MOUSE_BUTTON_CALLBACK_t) * cfg->mouse_button_callbacks, LF_MEM_GENERAL);
+  state.input.scroll_cbs = (SCROLL_CALLBACK_t*)mem_alloc(sizeof(SCROLL_CALLBACK_t) * cfg->scroll_callbacks, LF_MEM_GENERAL);
+  state.input.cursor_pos_cbs = (CURSOR_CALLBACK_t*)mem_alloc(sizeof(CURSOR_CALLBACK_t) * cfg->cursor_pos_callbacks, LF_MEM_GENERAL);
+
+  state.arena.size = cfg->frame_arena_size;
+  state.arena.base = (uint8_t*)mem_alloc(state.arena.size, LF_MEM_FRAME_SCRATCH);
+
+  state.text_cache.capacity = cfg->text_cache_capacity;
+  state.text_cache.free_head = state.text_cache.lru_head = state.text_cache.lru_tail = LF_TEXT_CACHE_NONE;
+
   // Default state
   state.init = true;
-  state.dsp_w = display_width;
-  state.dsp_h = display_height;
-  state.window_handle = glfw_window;
+  state.dsp_w = cfg->display_width;
+  state.dsp_h = cfg->display_height;
   state.input.mouse.first_mouse_press = true;
-  state.render.tex_count = 0;
   state.pos_ptr = (vec2s){0, 0};
   state.image_color_stack = LF_NO_COLOR;
   state.active_element_id = 0;
   state.text_wrap = false;
   state.line_overflow = true;
-  state.theme = lf_default_theme();
   state.renderer_render = true;
   state.drag_state = (DragState){ false, {0, 0}, 0 };
+  state.cull_start = (vec2s){-1, -1};
+  state.cull_end = (vec2s){-1, -1};
+
+  // The backend needs to be up before any font or texture is loaded
+  LfRenderBackend backend = cfg->backend;
+  state.render.backend = backend;
+  if(backend.init && !backend.init(backend.user_data, state.dsp_w, state.dsp_h)) {
+    LF_ERROR("Failed to initialize the '%s' render backend.", backend.name ? backend.name : "unnamed");
+    state.init = false;
+    return;
+  }
+  glyph_atlas_init();
+  state.theme = lf_default_theme();
 
   props_stack_create(&state.props_stack);
 
@@ -1731,23 +4307,129 @@ void lf_init_glfw(uint32_t display_width, uint32_t display_height, void* glfw_wi
 
   state.clipboard = clipboard_new(NULL);
 
-  state.drawcalls = 0;
-
-  // Setting glfw callbacks
-  glfwSetKeyCallback((GLFWwindow*)state.window_handle, glfw_key_callback);
-  glfwSetMouseButtonCallback((GLFWwindow*)state.window_handle, glfw_mouse_button_callback);
-  glfwSetScrollCallback((GLFWwindow*)state.window_handle, glfw_scroll_callback);
-  glfwSetCursorPosCallback((GLFWwindow*)state.window_handle, glfw_cursor_callback);
-  glfwSetCharCallback((GLFWwindow*)state.window_handle, glfw_char_callback);
-  renderer_init();
-
   state.tex_arrow_down = lf_load_texture_asset("arrow-down", "png");
   state.tex_tick = lf_load_texture_asset("tick", "png");
+}
+
+// ===========================================================
+// ----------------Public API Functions ---------------------- 
+// ===========================================================
+bool lf_set_allocator(const LfAllocator* alloc) {
+  for(uint32_t i = 0; i < LF_MEM_CATEGORY_COUNT; i++) {
+    if(mem_usage[i]) {
+      LF_ERROR("Cannot change the allocator while leif still holds memory allocated by the current one.");
+      return false;
+    }
+  }
+  if(alloc) 
+    allocator = *alloc;
+  else 
+    allocator = (LfAllocator){.alloc = default_alloc, .realloc = default_realloc, .free = default_free};
+  return true;
+}
+
+size_t lf_get_memory_usage(LfMemCategory category) {
+  return category < LF_MEM_CATEGORY_COUNT ? mem_usage[category] : 0;
+}
+
+void lf_init_ex(const LfConfig* config) {
+  LfConfig cfg = *config;
+  if(cfg.glfw_window) {
+#ifndef LF_GLFW
+    LF_ERROR("Trying to initialize Leif with GLFW without defining 'LF_GLFW'");
+    return;
+#else 
+    if(!glfwInit()) {
+      LF_ERROR("Trying to initialize Leif with GLFW without initializing GLFW first.");
+      return;
+    }
+
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      LF_ERROR("Failed to initialize Glad.");
+      return;
+    }
+#endif
+  }
+  if(!cfg.backend.init && !cfg.backend.render && !cfg.backend.create_texture) 
+    cfg.backend = lf_gl_backend();
+
+  init_state(&cfg);
+  if(!state.init) return;
+
+#ifdef LF_GLFW
+  if(cfg.glfw_window) {
+    state.window_handle = cfg.glfw_window;
+
+    // Setting glfw callbacks
+    glfwSetKeyCallback((GLFWwindow*)state.window_handle, glfw_key_callback);
+    glfwSetMouseButtonCallback((GLFWwindow*)state.window_handle, glfw_mouse_button_callback);
+    glfwSetScrollCallback((GLFWwindow*)state.window_handle, glfw_scroll_callback);
+    glfwSetCursorPosCallback((GLFWwindow*)state.window_handle, glfw_cursor_callback);
+    glfwSetCharCallback((GLFWwindow*)state.window_handle, glfw_char_callback);
+  }
 #endif
 }
 
+void lf_init_glfw(uint32_t display_width, uint32_t display_height, void* glfw_window) {
+#ifndef LF_GLFW
+  LF_ERROR("Trying to initialize Leif with GLFW without defining 'LF_GLFW'");
+  return;
+#else 
+  LfConfig config = {0};
+  config.display_width = display_width;
+  config.display_height = display_height;
+  config.glfw_window = glfw_window;
+  config.backend = lf_gl_backend();
+  lf_init_ex(&config);
+#endif
+}
+
+void lf_init_headless(uint32_t display_width, uint32_t display_height, LfRenderBackend backend) {
+  LfConfig config = {0};
+  config.display_width = display_width;
+  config.display_height = display_height;
+  config.backend = backend;
+  lf_init_ex(&config);
+}
+
 void lf_terminate() {
   lf_free_font(&state.theme.font);
+  glyph_atlas_free();
+  if(state.render.backend.terminate) 
+    state.render.backend.terminate(state.render.backend.user_data);
+
+  if(state.render.recorded_instances) 
+    state.render.list.instances = state.render.recorded_instances;
+  state.render.recorded_instances = NULL;
+  mem_free(state.render.list.instances);
+  mem_free(state.render.list.cmds);
+  mem_free(state.render.list.textures);
+  mem_free(state.render.list.clips);
+  mem_free(state.clip_stack);
+  mem_free(state.props_stack.data);
+  memset(&state.props_stack, 0, sizeof(state.props_stack));
+  mem_free(state.input.key_cbs);
+  mem_free(state.input.mouse_button_cbs);
+  mem_free(state.input.scroll_cbs);
+  mem_free(state.input.cursor_pos_cbs);
+  arena_free();
+  text_cache_free();
+  memset(&state.input, 0, sizeof(state.input));
+  state.clip_stack = NULL;
+  state.clip_stack_count = state.clip_stack_cap = 0;
+  memset(&state.render.list, 0, sizeof(LfDrawList));
+
+  mem_free(state.render.batch_instances);
+  mem_free(state.render.batch_of);
+  mem_free(state.render.batch_links);
+  mem_free(state.render.batch_cmds);
+  mem_free(state.render.batches);
+  state.render.batch_instances = NULL;
+  state.render.batch_of = NULL;
+  state.render.batch_links = NULL;
+  state.render.batch_cmds = NULL;
+  state.render.batches = NULL;
+  state.render.batch_instance_cap = state.render.batch_of_cap = state.render.batch_cmd_cap = state.render.batch_cap = 0;
 }
 
 LfTheme lf_default_theme() {
@@ -1880,18 +4562,50 @@ void lf_resize_display(uint32_t display_width, uint32_t display_height) {
   state.dsp_w = display_width;
   state.dsp_h = display_height;
 
-  set_projection_matrix();
+  if(state.render.backend.resize) 
+    state.render.backend.resize(state.render.backend.user_data, display_width, display_height);
 
   state.current_div.aabb.size.x = state.dsp_w;
   state.current_div.aabb.size.y = state.dsp_h;
 }
 
 LfFont lf_load_font(const char* filepath, uint32_t size) {
-  return load_font(filepath, size, 1024, 1024, 0);
+  return load_font(filepath, size, 
+                   state.config.font_atlas_width ? state.config.font_atlas_width : LF_FONT_ATLAS_SIZE, 
+                   state.config.font_atlas_height ? state.config.font_atlas_height : LF_FONT_ATLAS_SIZE, 0, false);
 }
 
 LfFont lf_load_font_ex(const char* filepath, uint32_t size, uint32_t bitmap_w, uint32_t bitmap_h) {
-  return load_font(filepath, size, bitmap_w, bitmap_h, 0);
+  return load_font(filepath, size, bitmap_w, bitmap_h, 0, false);
+}
+
+LfFont lf_load_font_sdf(const char* filepath, uint32_t size) {
+  return load_font(filepath, size, state.atlas.width, state.atlas.height, 0, true);
+}
+
+LfFont lf_load_font_from_memory(const void* data, size_t data_size, uint32_t size) {
+  FontFace* face = font_face_from_memory(data, data_size);
+  if(!face) return (LfFont){0};
+  return font_create(face, size, 0, false);
+}
+
+LfFont lf_load_font_sdf_from_memory(const void* data, size_t data_size, uint32_t size) {
+  FontFace* face = font_face_from_memory(data, data_size);
+  if(!face) return (LfFont){0};
+  return font_create(face, size, 0, true);
+}
+
+LfFont lf_font_view(const LfFont* font, uint32_t size) {
+  if(!font->sdf) {
+    LF_ERROR("Views can only be created of SDF fonts (lf_load_font_sdf()).");
+    return *font;
+  }
+  LfFont view = *font;
+  view.view = true;
+  view.font_size = size;
+  view.render_scale = (float)size / LF_SDF_SIZE;
+  font_set_metrics(&view);
+  return view;
 }
 
 LfTexture lf_load_texture(const char* filepath, bool flip, LfTextureFiltering filter) {
@@ -1903,30 +4617,11 @@ LfTexture lf_load_texture(const char* filepath, bool flip, LfTextureFiltering fi
     return tex;
   }
 
-  glGenTextures(1, &tex.id);
-  glBindTexture(GL_TEXTURE_2D, tex.id); 
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  switch(filter) {
-    case LF_TEX_FILTER_LINEAR:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      break;
-    case LF_TEX_FILTER_NEAREST:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      break;
-  }
-
-  // Load texture data
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  stbi_image_free(image); // Free image data 
-  //
+  // Creating the texture with the render backend
   tex.width = width;
   tex.height = height;
+  renderer_create_texture(&tex, image, 4, filter, false);
+  stbi_image_free(image); // Free image data 
   return tex;
 }
 
@@ -1935,36 +4630,18 @@ LfTexture lf_load_texture_resized(const char* filepath, bool flip, LfTextureFilt
   int32_t width, height, channels;
   stbi_uc* image_data = stbi_load(filepath, &width, &height, &channels, 0);
 
-  unsigned char* downscaled_image = (unsigned char*)malloc(sizeof(unsigned char) * w * h * channels);
+  unsigned char* downscaled_image = (unsigned char*)mem_alloc(sizeof(unsigned char) * w * h * channels, LF_MEM_TEXTURE_STAGING);
 
   // Resize the original image to the downscaled size
   stbir_resize_uint8_linear(image_data, width, height, 0, downscaled_image, w, h, 0,(stbir_pixel_layout)channels);
 
-  glCreateTextures(GL_TEXTURE_2D, 1, &tex.id);
-  glBindTexture(GL_TEXTURE_2D, tex.id);
-
-  switch(filter) {
-    case LF_TEX_FILTER_LINEAR:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      break;
-    case LF_TEX_FILTER_NEAREST:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      break;
-  }
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, downscaled_image);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  // Creating the texture with the render backend
+  tex.width = w;
+  tex.height = h;
+  renderer_create_texture(&tex, downscaled_image, channels, filter, false);
 
   stbi_image_free(image_data);
-  free(downscaled_image);
-
-  tex.width = width;
-  tex.height = height;
+  mem_free(downscaled_image);
 
   return tex;
 
@@ -1985,7 +4662,7 @@ LfTexture lf_load_texture_resized_factor(const char* filepath, bool flip, LfText
   int32_t h = height * hfactor;
   lf_create_texture_from_image_data(filter, &tex.id, w, h, channels, data);
 
-  free(data);
+  mem_free(data);
 
   tex.width = w;
   tex.height = h;
@@ -2001,29 +4678,11 @@ LfTexture lf_load_texture_from_memory(const void* data, size_t size, bool flip,
     return tex;
   }
 
-  glGenTextures(1, &tex.id);
-  glBindTexture(GL_TEXTURE_2D, tex.id); 
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  switch(filter) {
-    case LF_TEX_FILTER_LINEAR:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      break;
-    case LF_TEX_FILTER_NEAREST:
-      glTextureParameteri(tex.id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(tex.id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      break;
-  }
-
-  // Load texture data
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  stbi_image_free(image); // Free image data 
+  // Creating the texture with the render backend
   tex.width = width;
   tex.height = height;
+  renderer_create_texture(&tex, image, 4, filter, false);
+  stbi_image_free(image); // Free image data 
   return tex;
 
 }
@@ -2050,7 +4709,7 @@ LfTexture lf_load_texture_from_memory_resized_factor(const void* data, size_t si
   int w = width * wfactor;
   int h = height * hfactor;
 
-  unsigned char* resized_data = (unsigned char*)malloc(sizeof(unsigned char) * w * h * channels);
+  unsigned char* resized_data = (unsigned char*)mem_alloc(sizeof(unsigned char) * w * h * channels, LF_MEM_TEXTURE_STAGING);
   stbir_resize_uint8_linear(image_data, width, height, 0, resized_data, w, h, 0,(stbir_pixel_layout)channels);
   stbi_image_free(image_data);
 
@@ -2089,7 +4748,7 @@ unsigned char* lf_load_texture_data(const char* filepath, int32_t* width, int32_
 unsigned char* lf_load_texture_data_resized(const char* filepath, int32_t w, int32_t h, int32_t* channels, bool flip) {
   int32_t width, height;
   stbi_uc* data = lf_load_texture_data(filepath, &width, &height, channels, flip);
-  unsigned char* downscaled_image = (unsigned char*)malloc(sizeof(unsigned char) * w * h * *channels);
+  unsigned char* downscaled_image = (unsigned char*)mem_alloc(sizeof(unsigned char) * w * h * *channels, LF_MEM_TEXTURE_STAGING);
   stbir_resize_uint8_linear(data, width, height, *channels, downscaled_image, w, h, 0,(stbir_pixel_layout)*channels);
   stbi_image_free(data);
   return downscaled_image;
@@ -2105,13 +4764,13 @@ unsigned char* lf_load_texture_data_resized_factor(const char* filepath, int32_t
   float h = (hfactor * (*height));
 
   size_t new_size = w * h * (*channels);
-  unsigned char* resized_data = (unsigned char*)malloc(new_size);
+  unsigned char* resized_data = (unsigned char*)mem_alloc(new_size, LF_MEM_TEXTURE_STAGING);
   if (resized_data == NULL) {
     return NULL;
   }
 
   stbir_resize_uint8_linear(image, *width, *height, *channels, resized_data, w, h, 0,(stbir_pixel_layout)*channels);
-  free(image);
+  stbi_image_free(image);
   return resized_data;
 
  }
@@ -2153,7 +4812,7 @@ unsigned char* lf_load_texture_data_from_memory_resized_to_fit_ex(const void* da
   if(o_height)
     *o_height = new_height;
 
-  unsigned char* resized_image = (unsigned char*)malloc(sizeof(unsigned char) * new_width * new_height * i_channels);
+  unsigned char* resized_image = (unsigned char*)mem_alloc(sizeof(unsigned char) * new_width * new_height * i_channels, LF_MEM_TEXTURE_STAGING);
   stbir_resize_uint8_linear(data, i_width, i_height, 0, resized_image, new_width, new_height, 0,(stbir_pixel_layout)i_channels);
   return resized_image;
 }
@@ -2180,45 +4839,41 @@ unsigned char* lf_load_texture_data_from_memory_resized_factor(const void* data,
   int w = (*width) * wfactor;
   int h = (*height) * hfactor;
 
-  unsigned char* resized_data = (unsigned char*)malloc(sizeof(unsigned char) * w * h * (*channels));
+  unsigned char* resized_data = (unsigned char*)mem_alloc(sizeof(unsigned char) * w * h * (*channels), LF_MEM_TEXTURE_STAGING);
   stbir_resize_uint8_linear(image_data, *width, *height, 0, resized_data, w, h, 0,(stbir_pixel_layout)*channels);
   stbi_image_free(image_data);
   return resized_data;
 }
 
 void lf_create_texture_from_image_data(LfTextureFiltering filter, uint32_t* id, int32_t width, int32_t height, int32_t channels, unsigned char* data) {
-  GLenum internal_format = (channels == 4) ? GL_RGBA8 : GL_RGB8;
-  GLenum data_format = (channels == 4) ? GL_RGBA : GL_RGB;
-  glGenTextures(1, id);
-  glBindTexture(GL_TEXTURE_2D, *id); 
-
-  // Set texture parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  switch(filter) {
-    case LF_TEX_FILTER_LINEAR:
-      glTextureParameteri(*id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      glTextureParameteri(*id, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-      break;
-    case LF_TEX_FILTER_NEAREST:
-      glTextureParameteri(*id, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTextureParameteri(*id, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      break;
-  }
-
-  // Load texture data
-  glTexImage2D(GL_TEXTURE_2D, 0, data_format, width, height, 0, data_format, GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  LfTexture tex = {.width = (uint32_t)width, .height = (uint32_t)height};
+  renderer_create_texture(&tex, data, channels, filter, false);
+  *id = tex.id;
 }
 
 void lf_free_texture(LfTexture* tex) {
-  glDeleteTextures(1, &tex->id);
+  if(state.render.backend.delete_texture)
+    state.render.backend.delete_texture(state.render.backend.user_data, tex);
   memset(tex, 0, sizeof(LfTexture));
 }
 
+void lf_free_texture_data(unsigned char* data) {
+  mem_free(data);
+}
+
 void lf_free_font(LfFont* font) {
-  free(font->cdata);
-  free(font->font_info);
+  // Views don't own the glyphs they draw
+  if(font->view) return;
+  if(font->glyph_pages) {
+    glyph_cache_close(font);
+    text_cache_purge_font(font->id);
+    glyph_atlas_purge_font(font->id);
+    for(uint32_t i = 0; i < LF_GLYPH_PAGE_COUNT; i++) 
+      mem_free(font->glyph_pages[i]);
+  }
+  mem_free(font->glyph_pages);
+  font_face_release((FontFace*)font->face);
+  memset(font, 0, sizeof(*font));
 }
 
 LfFont lf_load_font_asset(const char* asset_name, const char* file_extension, uint32_t font_size) {
@@ -2257,17 +4912,33 @@ LfTexture lf_load_texture_asset(const char* asset_name, const char* file_extensi
 }
 
 void lf_add_key_callback(void* cb) {
+  if(state.input.key_cb_count >= state.config.key_callbacks) {
+    LF_ERROR("Trying to add more than %u key callbacks.", state.config.key_callbacks);
+    return;
+  }
   state.input.key_cbs[state.input.key_cb_count++] = (KEY_CALLBACK_t)cb;
 }
 void lf_add_mouse_button_callback(void* cb) {
+  if(state.input.mouse_button_cb_count >= state.config.mouse_button_callbacks) {
+    LF_ERROR("Trying to add more than %u mouse button callbacks.", state.config.mouse_button_callbacks);
+    return;
+  }
   state.input.mouse_button_cbs[state.input.mouse_button_cb_count++] = (MOUSE_BUTTON_CALLBACK_t)cb;
 }
 
 void lf_add_scroll_callback(void* cb) {
+  if(state.input.scroll_cb_count >= state.config.scroll_callbacks) {
+    LF_ERROR("Trying to add more than %u scroll callbacks.", state.config.scroll_callbacks);
+    return;
+  }
   state.input.scroll_cbs[state.input.scroll_cb_count++] = (SCROLL_CALLBACK_t)cb;
 }
 
 void lf_add_cursor_pos_callback(void* cb) {
+  if(state.input.cursor_pos_cb_count >= state.config.cursor_pos_callbacks) {
+    LF_ERROR("Trying to add more than %u cursor position callbacks.", state.config.cursor_pos_callbacks);
+    return;
+  }
   state.input.cursor_pos_cbs[state.input.cursor_pos_cb_count++] = (CURSOR_CALLBACK_t)cb;
 }
 
@@ -2397,6 +5068,7 @@ LfDiv* _lf_div_begin_loc(vec2s pos, vec2s size, bool scrollable, float* scroll,
   } else {
     lf_set_ptr_y(props.border_width + props.corner_radius);
   }
+  clip_stack_push();
   state.cull_start = (vec2s){pos.x, pos.y + props.border_width};
   state.cull_end = (vec2s){pos.x + size.x - props.border_width, pos.y + size.y - props.border_width};
 
@@ -2417,8 +5089,7 @@ void lf_div_end() {
   state.font_stack = state.prev_font_stack;
   state.current_line_height = state.prev_line_height;
   state.current_div = state.prev_div;
-  state.cull_start = (vec2s){-1, -1};
-  state.cull_end = (vec2s){-1, -1};
+  clip_stack_pop();
 }
 
 
@@ -2785,7 +5456,17 @@ LfDiv lf_get_grabbed_div() {
 }
 
 void _lf_begin_loc(const char* file, int32_t line) {
+  memset(&state.render.stats, 0, sizeof(state.render.stats));
+  state.render.frame_start = get_time();
+  arena_reset();
+  state.atlas.frame++;
+  state.text_cache.frame++;
+  if(state.atlas.full) 
+    glyph_atlas_clear();
   state.pos_ptr = (vec2s){0, 0};
+  state.clip_stack_count = 0;
+  state.cull_start = (vec2s){-1, -1};
+  state.cull_end = (vec2s){-1, -1};
   renderer_begin();
   LfUIElementProps props = get_props_for(state.theme.div_props);
   props.color = (LfColor){0, 0, 0, 0};
@@ -2803,7 +5484,18 @@ void lf_end() {
   update_input();
   clear_events();
   renderer_flush();
-  state.drawcalls = 0;
+
+  // Finishing the statistics of the frame
+  LfFrameStats* stats = &state.render.stats;
+  stats->draw_cmds = state.render.list.cmd_count;
+  stats->instances = state.render.list.instance_count;
+  stats->vertices = stats->instances * 4;
+  stats->glyphs = state.render.list.pipeline_counts[LF_PIPELINE_GLYPH] + state.render.list.pipeline_counts[LF_PIPELINE_GLYPH_SDF];
+  stats->flushes[LF_FLUSH_END_OF_FRAME]++;
+  stats->arena_bytes = state.arena.used + state.arena.overflow_bytes;
+  stats->text_cache_bytes = state.text_cache.bytes;
+  stats->cpu_time = get_time() - state.render.frame_start;
+  state.render.frame_stats = *stats;
 }
 
 void lf_next_line() {
@@ -2858,29 +5550,41 @@ void lf_text(const char* text) {
   LfColor color = props.color;
   LfFont font = get_current_font();
 
+  // Laying out the text once for the position it is rendered at
+  float wrap_point = (state.current_div.aabb.size.x + state.current_div.aabb.pos.x) - margin_right - margin_left;
+  float text_x = state.pos_ptr.x + margin_left + padding;
+  float wrap_width = state.text_wrap ? wrap_point - text_x : -1.0f;
+  TextLayout layout = {0};
+  TextCacheEntry* entry = text_cache_get(text, &font, wrap_width);
+  if(!entry) 
+    layout = text_layout(text, &font, wrap_width, -1);
+  float width = entry ? entry->width : layout.width;
+  float height = entry ? entry->height : font.max_char_height + (float)(layout.line_count - 1) * font.font_size;
+
   // Advancing to the next line if the the text does not fit on the current div
-  LfTextProps text_props = lf_text_render(state.pos_ptr, text, font, text_color, 
-                                          state.text_wrap ? 
-                                          (state.current_div.aabb.size.x + state.current_div.aabb.pos.x) - margin_right - margin_left 
-                                          : 
-                                          -1, 
-                                          (vec2s){-1, -1}, true, false, -1, -1);
+  float line_x = state.pos_ptr.x;
   next_line_on_overflow(
-    (vec2s){text_props.width + padding * 2.0f + margin_left + margin_right,
-      text_props.height + padding * 2.0f + margin_top + margin_bottom}, 
+    (vec2s){width + padding * 2.0f + margin_left + margin_right,
+      height + padding * 2.0f + margin_top + margin_bottom}, 
     state.div_props.border_width);
 
   // Advancing the position pointer by the margins
   state.pos_ptr.x += margin_left;
   state.pos_ptr.y += margin_top;
 
-  // Rendering a colored text box if a color is specified
+  // Wrapped text is laid out again if it moved to the next line
+  if(state.text_wrap && state.pos_ptr.x - margin_left != line_x) {
+    wrap_width = wrap_point - (state.pos_ptr.x + padding);
+    entry = text_cache_get(text, &font, wrap_width);
+    if(!entry) 
+      layout = text_layout(text, &font, wrap_width, -1);
+  }
+
   // Rendering the text
-  lf_text_render((vec2s){state.pos_ptr.x + padding, state.pos_ptr.y + padding}, text, font, text_color, 
-                 state.text_wrap ? 
-                 (state.current_div.aabb.size.x + state.current_div.aabb.pos.x) - margin_right - margin_left 
-                 : 
-                 -1, (vec2s){-1, -1}, false, false, -1, -1);
+  vec2s text_pos = (vec2s){state.pos_ptr.x + padding, state.pos_ptr.y + padding};
+  LfTextProps text_props = entry ? 
+    text_cache_emit(entry, text_pos, &font, text_color, false) : 
+    text_layout_emit(&layout, text_pos, text, &font, text_color, (vec2s){-1, -1}, false, false, -1);
 
   // Advancing the position pointer by the width of the text
   state.pos_ptr.x += text_props.width + margin_right + padding;
@@ -2922,6 +5626,272 @@ void lf_text_wide(const wchar_t* text) {
   state.pos_ptr.y -= margin_top;
 }
 
+void text_view_index(LfTextView* view) {
+  // Text that got shorter was replaced, it is indexed from the start again
+  if(view->len < view->_indexed_len) {
+    view->_index_count = 0;
+    view->_newlines = 0;
+    view->_indexed_len = 0;
+  }
+  if(!view->_index_count) {
+    view->_index_cap = view->_index_cap ? view->_index_cap : 64;
+    view->_index = (size_t*)mem_realloc(view->_index, sizeof(size_t) * view->_index_cap, LF_MEM_GENERAL);
+    view->_index[view->_index_count++] = 0;
+  }
+
+  // Only the appended bytes are scanned for line breaks
+  size_t b = view->_indexed_len;
+  while(b < view->len) {
+    const char* nl = (const char*)memchr(view->buf + b, '\n', view->len - b);
+    if(!nl) break;
+    b = (size_t)(nl - view->buf) + 1;
+    if(++view->_newlines % LF_TEXT_VIEW_INDEX_STRIDE != 0) continue;
+    if(view->_index_count >= view->_index_cap) {
+      view->_index_cap *= 2;
+      view->_index = (size_t*)mem_realloc(view->_index, sizeof(size_t) * view->_index_cap, LF_MEM_GENERAL);
+    }
+    view->_index[view->_index_count++] = b;
+  }
+  view->_indexed_len = view->len;
+}
+
+void lf_text_view(LfTextView* view) {
+  LfUIElementProps props = get_props_for(state.theme.text_props);
+  float padding = props.padding;
+  LfFont font = get_current_font();
+
+  uint32_t line_count = view->line_count;
+  if(!view->get_line) {
+    text_view_index(view);
+    line_count = view->len ? view->_newlines + 1 : 0;
+  }
+
+  // The view reserves the height of every line so the div scrolls over the whole text
+  float line_height = (float)font.font_size;
+  float width = (state.current_div.aabb.pos.x + state.current_div.aabb.size.x) - state.pos_ptr.x - 
+    props.margin_left - props.margin_right - padding * 2.0f;
+  float height = line_count ? font.max_char_height + (float)(line_count - 1) * line_height : 0.0f;
+  next_line_on_overflow(
+    (vec2s){width + padding * 2.0f + props.margin_left + props.margin_right,
+      height + padding * 2.0f + props.margin_top + props.margin_bottom}, 
+    state.div_props.border_width);
+
+  state.pos_ptr.x += props.margin_left;
+  state.pos_ptr.y += props.margin_top;
+
+  // Laying out the lines within the scroll window only
+  vec2s origin = (vec2s){state.pos_ptr.x + padding, state.pos_ptr.y + padding};
+  uint32_t first, last;
+  text_visible_lines(origin.y, &font, line_count, &first, &last);
+  size_t offset = 0;
+  if(!view->get_line && first < last) {
+    // Walking from the closest indexed line to the first visible one
+    offset = view->_index[first / LF_TEXT_VIEW_INDEX_STRIDE];
+    for(uint32_t k = first % LF_TEXT_VIEW_INDEX_STRIDE; k > 0; k--) 
+      offset = (size_t)((const char*)memchr(view->buf + offset, '\n', view->len - offset) - view->buf) + 1;
+  }
+  for(uint32_t l = first; l < last && state.renderer_render; l++) {
+    const char* line;
+    uint32_t len;
+    if(view->get_line) {
+      line = view->get_line(view->user_data, l, &len);
+      if(!line) continue;
+    } else {
+      line = view->buf + offset;
+      const char* nl = (const char*)memchr(line, '\n', view->len - offset);
+      len = (uint32_t)(nl ? (size_t)(nl - line) : view->len - offset);
+      offset += len + 1;
+    }
+    if(len && line[len - 1] == '\r') len--;
+
+    // Cutting very long lines at a character boundary
+    if(len > LF_TEXT_VIEW_MAX_LINE) {
+      len = LF_TEXT_VIEW_MAX_LINE;
+      while(len && ((uint8_t)line[len] & 0xC0) == 0x80) len--;
+    }
+    if(!len) continue;
+
+    char* str = (char*)arena_alloc(len + 1);
+    memcpy(str, line, len);
+    str[len] = '\0';
+    TextLayout layout = text_layout(str, &font, -1.0f, -1);
+    text_layout_emit(&layout, (vec2s){origin.x, origin.y + (float)l * line_height}, str, &font, props.text_color, 
+                     (vec2s){-1, -1}, false, false, -1);
+  }
+
+  state.pos_ptr.x += width + padding * 2.0f + props.margin_right;
+  state.pos_ptr.y -= props.margin_top;
+}
+
+void lf_text_view_free(LfTextView* view) {
+  mem_free(view->_index);
+  view->_index = NULL;
+  view->_index_count = view->_index_cap = 0;
+  view->_newlines = 0;
+  view->_indexed_len = 0;
+}
+
+CharGridCache* char_grid_cache(LfCharGrid* grid, const LfFont* font) {
+  CharGridCache* cache = (CharGridCache*)grid->_cache;
+  if(cache && (cache->cols != grid->cols || cache->rows != grid->rows)) {
+    lf_char_grid_free(grid);
+    cache = NULL;
+  }
+  if(!cache) {
+    cache = (CharGridCache*)mem_calloc(1, sizeof(CharGridCache), LF_MEM_BATCH);
+    cache->cols = grid->cols;
+    cache->rows = grid->rows;
+    size_t cells = (size_t)grid->cols * grid->rows;
+    cache->cells = (LfCharCell*)mem_alloc(sizeof(LfCharCell) * cells, LF_MEM_BATCH);
+    cache->row_data = (CharGridRow*)mem_calloc(grid->rows, sizeof(CharGridRow), LF_MEM_BATCH);
+    cache->instances = (LfDrawInstance*)mem_alloc(sizeof(LfDrawInstance) * cells * 2, LF_MEM_BATCH);
+    cache->glyphs = (LfGlyph**)mem_alloc(sizeof(LfGlyph*) * cells, LF_MEM_BATCH);
+    grid->_cache = cache;
+  }
+  // Rows built with another font are built again
+  if(cache->font_id != font->id || cache->font_size != font->font_size) {
+    cache->font_id = font->id;
+    cache->font_size = font->font_size;
+    for(uint32_t i = 0; i < cache->rows; i++) 
+      cache->row_data[i].built = false;
+  }
+  return cache;
+}
+
+bool char_grid_build_row(CharGridCache* cache, uint32_t row, const LfFont* font, float cell_width) {
+  // Building the instances from the cells the cache holds for the row, fails if a glyph couldn't be rasterized
+  const LfCharCell* cells = &cache->cells[(size_t)row * cache->cols];
+  LfDrawInstance* instances = &cache->instances[(size_t)row * cache->cols * 2];
+  LfGlyph** glyphs = &cache->glyphs[(size_t)row * cache->cols];
+  const float line_height = (float)font->font_size;
+  const float y = (float)row * line_height;
+  uint32_t n = 0, g = 0;
+
+  // Neighbouring cells of one background color share a rect
+  for(uint32_t c = 0; c < cache->cols;) {
+    LfColor bg = cells[c].bg;
+    uint32_t end = c + 1;
+    while(end < cache->cols && memcmp(&cells[end].bg, &bg, sizeof(bg)) == 0) end++;
+    if(bg.a) {
+      renderer_fill_instance(&instances[n++], (vec2s){(float)c * cell_width, y}, (vec2s){(float)(end - c) * cell_width, line_height}, 
+                             (vec4s){0.0f, 0.0f, 1.0f, 1.0f}, bg, LF_NO_COLOR, 0.0f, 0.0f, LF_NO_TEXTURE, LF_PIPELINE_SOLID);
+    }
+    c = end;
+  }
+
+  // Glyphs are positioned on whole pixels like text, the grid origin is too
+  const float render_scale = font->render_scale;
+  const float max_descended_char_height = (float)(int32_t)font->max_char_height;
+  bool complete = true;
+  for(uint32_t c = 0; c < cache->cols; c++) {
+    if(cells[c].codepoint <= ' ') continue;
+    LfGlyph* glyph = font_glyph(font, cells[c].codepoint);
+    if(!glyph || glyph->width <= 0.0f || glyph->height <= 0.0f) continue;
+    if(!glyph_atlas_ensure(font, glyph)) {
+      complete = false;
+      continue;
+    }
+    glyphs[g++] = glyph;
+    renderer_fill_instance(&instances[n++], 
+                           (vec2s){floorf((float)c * cell_width + glyph->xoff * render_scale + 0.5f), 
+                           floorf(y + glyph->yoff * render_scale + 0.5f) + max_descended_char_height}, 
+                           (vec2s){glyph->width * render_scale, glyph->height * render_scale}, 
+                           (vec4s){glyph->s0, glyph->t0, glyph->s1, glyph->t1}, 
+                           cells[c].fg, LF_NO_COLOR, 0.0f, 0.0f, 0, font->sdf ? LF_PIPELINE_GLYPH_SDF : LF_PIPELINE_GLYPH);
+  }
+  cache->row_data[row].instance_count = n;
+  cache->row_data[row].glyph_count = g;
+  return complete;
+}
+
+void lf_char_grid(LfCharGrid* grid) {
+  LfUIElementProps props = get_props_for(state.theme.text_props);
+  LfFont font = get_current_font();
+
+  float cell_width = font.mono_advance * font.render_scale;
+  if(cell_width == 0.0f) {
+    LfGlyph* glyph = font_glyph(&font, 'M');
+    cell_width = glyph ? glyph->advance * font.render_scale : font.font_size * 0.5f;
+  }
+  float width = (float)grid->cols * cell_width;
+  float height = (float)grid->rows * font.font_size;
+  next_line_on_overflow(
+    (vec2s){width + props.padding * 2.0f + props.margin_left + props.margin_right,
+      height + props.padding * 2.0f + props.margin_top + props.margin_bottom}, 
+    state.div_props.border_width);
+
+  state.pos_ptr.x += props.margin_left;
+  state.pos_ptr.y += props.margin_top;
+
+  if(state.renderer_render && grid->cols && grid->rows) {
+    CharGridCache* cache = char_grid_cache(grid, &font);
+    vec2s origin = (vec2s){
+      floorf(state.pos_ptr.x + props.padding + 0.5f), 
+      floorf(state.pos_ptr.y + props.padding + 0.5f)
+    };
+    uint16_t tex_index = renderer_tex_slot(font.bitmap);
+
+    // Rows within the clipping area are appended as they are unless their cells changed 
+    // or glyphs they use were evicted from the atlas since they were built
+    uint32_t first, last;
+    text_visible_lines(origin.y, &font, grid->rows, &first, &last);
+    for(uint32_t r = first; r < last; r++) {
+      CharGridRow* row = &cache->row_data[r];
+      const LfCharCell* cells = &grid->cells[(size_t)r * grid->cols];
+      LfCharCell* built = &cache->cells[(size_t)r * grid->cols];
+      if(!row->built || row->generation != state.atlas.generation || 
+        memcmp(cells, built, sizeof(LfCharCell) * grid->cols) != 0) {
+        memcpy(built, cells, sizeof(LfCharCell) * grid->cols);
+        row->built = char_grid_build_row(cache, r, &font, cell_width);
+      } else {
+        // Keeping the glyphs of the row in the atlas
+        LfGlyph** glyphs = &cache->glyphs[(size_t)r * grid->cols];
+        for(uint32_t i = 0; i < row->glyph_count; i++) 
+          glyph_atlas_ensure(&font, glyphs[i]);
+      }
+      renderer_add_instances(&cache->instances[(size_t)r * grid->cols * 2], row->instance_count, origin, tex_index);
+    }
+    // Glyphs of the appended rows are used this frame, so later evictions didn't touch them
+    for(uint32_t r = first; r < last; r++) 
+      cache->row_data[r].generation = state.atlas.generation;
+  }
+
+  state.pos_ptr.x += width + props.padding * 2.0f + props.margin_right;
+  state.pos_ptr.y -= props.margin_top;
+}
+
+void lf_char_grid_free(LfCharGrid* grid) {
+  CharGridCache* cache = (CharGridCache*)grid->_cache;
+  if(!cache) return;
+  mem_free(cache->cells);
+  mem_free(cache->row_data);
+  mem_free(cache->instances);
+  mem_free(cache->glyphs);
+  mem_free(cache);
+  grid->_cache = NULL;
+}
+
+void lf_textf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  char* text = arena_vsprintf(fmt, args);
+  va_end(args);
+  if(text) 
+    lf_text(text);
+}
+
+void* lf_frame_alloc(size_t size) {
+  return arena_alloc(size);
+}
+
+char* lf_frame_sprintf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  char* str = arena_vsprintf(fmt, args);
+  va_end(args);
+  return str;
+}
+
 void lf_set_text_wrap(bool wrap) {
   state.text_wrap = wrap;
 }
@@ -2980,392 +5950,748 @@ void lf_pop_font() {
   state.font_stack = NULL;
 }
 
-// Decode a UTF-8 character sequence to Unicode code point
-uint32_t decode_utf8(const char *s, int *bytes_read) {
-    uint8_t c = s[0];
-    if (c < 0x80) {
-        *bytes_read = 1;
-        return c;
-    } else if (c < 0xE0) {
-        *bytes_read = 2;
-        return ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
-    } else if (c < 0xF0) {
-        *bytes_read = 3;
-        return ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
-    } else {
-        *bytes_read = 4;
-        return ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
-    }
-}
-
-static void renderer_add_glyph(stbtt_aligned_quad q, int32_t max_descended_char_height, LfColor color, uint32_t tex_index) {
-  vec2s texcoords[4] = {
-    q.s0, q.t0, 
-    q.s1, q.t0, 
-    q.s1, q.t1, 
-    q.s0, q.t1
+// Decodes the UTF-8 sequence at s, invalid or truncated sequences decode to U+FFFD and consume one byte 
+static inline uint32_t utf8_decode(const uint8_t* s, uint32_t* len) {
+  // Sequence length by the upper 5 bits of the lead byte, 0 for continuation & invalid bytes
+  static const uint8_t lengths[32] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 
+    0, 0, 0, 0, 0, 0, 0, 0, 
+    2, 2, 2, 2, 3, 3, 4, 0
   };
-  vec2s verts[4] = {
-    (vec2s){q.x0, q.y0 + max_descended_char_height}, 
-    (vec2s){q.x1, q.y0 + max_descended_char_height}, 
-    (vec2s){q.x1, q.y1 + max_descended_char_height},
-    (vec2s){q.x0, q.y1 + max_descended_char_height}
-  }; 
-  for(uint32_t i = 0; i < 4; i++) {
-    if(state.render.vert_count >= MAX_RENDER_BATCH) {
-      renderer_flush();
-      renderer_begin();
-    }
-    const vec2 verts_arr = {verts[i].x, verts[i].y};
-    memcpy(state.render.verts[state.render.vert_count].pos, verts_arr, sizeof(vec2));
-
-    const vec4 border_color = {0, 0, 0, 0};
-    memcpy(state.render.verts[state.render.vert_count].border_color, border_color, sizeof(vec4));
-
-    state.render.verts[state.render.vert_count].border_width = 0;
-
-    vec4s color_zto = lf_color_to_zto(color);
-    const vec4 color_arr = {color_zto.r, color_zto.g, color_zto.b, color_zto.a};
-    memcpy(state.render.verts[state.render.vert_count].color, color_arr, sizeof(vec4));
-
-    const vec2 texcoord_arr = {texcoords[i].x, texcoords[i].y};
-    memcpy(state.render.verts[state.render.vert_count].texcoord, texcoord_arr, sizeof(vec2));
-
-    state.render.verts[state.render.vert_count].tex_index = tex_index;
-
-    const vec2 scale_arr = {0, 0};
-    memcpy(state.render.verts[state.render.vert_count].scale, scale_arr, sizeof(vec2));
-
-    const vec2 pos_px_arr = {0, 0};
-    memcpy(state.render.verts[state.render.vert_count].pos_px, pos_px_arr, sizeof(vec2));
-
-    state.render.verts[state.render.vert_count].corner_radius = 0;
-
-    const vec2 cull_start_arr = {state.cull_start.x, state.cull_start.y};
-    const vec2 cull_end_arr = {state.cull_end.x, state.cull_end.y};
-    memcpy(state.render.verts[state.render.vert_count].min_coord, cull_start_arr, sizeof(vec2));
-    memcpy(state.render.verts[state.render.vert_count].max_coord, cull_end_arr, sizeof(vec2));
-
-    state.render.vert_count++;
+  static const uint8_t lead_masks[5] = {0x00, 0x7f, 0x1f, 0x0f, 0x07};
+  uint32_t n = lengths[s[0] >> 3];
+  *len = 1;
+  if(n <= 1) 
+    return n ? s[0] : 0xFFFD;
+
+  uint32_t cp = s[0] & lead_masks[n];
+  for(uint32_t k = 1; k < n; k++) {
+    // Also stops at the terminator of truncated sequences
+    if((s[k] & 0xC0) != 0x80) return 0xFFFD;
+    cp = (cp << 6) | (s[k] & 0x3F);
   }
-  state.render.index_count += 6; 
-}
-
-
-static wchar_t* str_to_wstr(const char* str) {
-    size_t len = strlen(str) + 1;
-
-    wchar_t* wstr = (wchar_t*)malloc(len * sizeof(wchar_t));
-    if (wstr == NULL) {
-        perror("Memory allocation failed");
-        return NULL;
+  *len = n;
+  return cp;
+}
+
+// Encodes a wide string as UTF-8 into the frame arena (wchar_t is UTF-16 on Windows & UTF-32 elsewhere)
+static char* wstr_to_utf8(const wchar_t* wstr) {
+  size_t len = wcslen(wstr);
+  uint8_t* out = (uint8_t*)arena_alloc(len * 4 + 1);
+  uint8_t* o = out;
+  for(size_t i = 0; i < len; i++) {
+    uint32_t cp = (uint32_t)wstr[i];
+    if(cp >= 0xD800 && cp <= 0xDBFF && i + 1 < len && 
+      (uint32_t)wstr[i + 1] >= 0xDC00 && (uint32_t)wstr[i + 1] <= 0xDFFF) {
+      cp = 0x10000 + ((cp - 0xD800) << 10) + ((uint32_t)wstr[i + 1] - 0xDC00);
+      i++;
     }
-    if (mbstowcs(wstr, str, len) == (size_t)-1) {
-        perror("Conversion failed");
-        free(wstr);
-        return NULL;
+    if(cp < 0x80) {
+      *o++ = cp;
+    } else if(cp < 0x800) {
+      *o++ = 0xC0 | (cp >> 6);
+      *o++ = 0x80 | (cp & 0x3F);
+    } else if(cp < 0x10000) {
+      *o++ = 0xE0 | (cp >> 12);
+      *o++ = 0x80 | ((cp >> 6) & 0x3F);
+      *o++ = 0x80 | (cp & 0x3F);
+    } else {
+      *o++ = 0xF0 | ((cp >> 18) & 0x07);
+      *o++ = 0x80 | ((cp >> 12) & 0x3F);
+      *o++ = 0x80 | ((cp >> 6) & 0x3F);
+      *o++ = 0x80 | (cp & 0x3F);
     }
-
-    return wstr;
+  }
+  *o = '\0';
+  return (char*)out;
 }
 
-LfTextProps lf_text_render(vec2s pos, const char* str, LfFont font, LfColor color, 
-                           int32_t wrap_point, vec2s stop_point, bool no_render, bool render_solid, int32_t start_index, int32_t end_index) {
-  wchar_t* wstr = str_to_wstr(str);
-  LfTextProps textprops =  lf_text_render_wchar(pos, (const wchar_t*)wstr, font, color, wrap_point, stop_point, no_render, render_solid, start_index, end_index);
-  free(wstr);
-  return textprops;
+static void renderer_add_glyph(const LfFont* font, const LfGlyph* glyph, float x, float y, LfColor color, uint16_t tex_index) {
+  renderer_add_instance(
+    (vec2s){x, y}, 
+    (vec2s){glyph->width * font->render_scale, glyph->height * font->render_scale}, 
+    (vec4s){glyph->s0, glyph->t0, glyph->s1, glyph->t1}, 
+    color, LF_NO_COLOR, 0.0f, 0.0f, tex_index, font->sdf ? LF_PIPELINE_GLYPH_SDF : LF_PIPELINE_GLYPH);
 }
 
 
 LfTextProps lf_text_render_wchar(vec2s pos, const wchar_t* str, LfFont font, LfColor color, 
                                  int32_t wrap_point, vec2s stop_point, bool no_render, bool render_solid, int32_t start_index, int32_t end_index) {
-  bool culled = item_should_cull((LfAABB){.pos = (vec2s){pos.x, pos.y + get_current_font().font_size}, .size = (vec2s){-1, -1}});
-
-  // Retrieving the texture index
-  float tex_index = -1.0f;
-  if (!culled && !no_render) {
-    if (state.render.tex_count - 1 >= MAX_TEX_COUNT_BATCH - 1) {
-      renderer_flush();
-      renderer_begin();
-    }
-    for (uint32_t i = 0; i < state.render.tex_count; i++) {
-      if (state.render.textures[i].id == font.bitmap.id) {
-        tex_index = (float)i;
-        break;
-      }
-    }
-    if (tex_index == -1.0f) {
-      tex_index = (float)state.render.tex_index;
-      LfTexture tex = font.bitmap;
-      state.render.textures[state.render.tex_count++] = tex;
-      state.render.tex_index++;
-    }
+  return lf_text_render(pos, wstr_to_utf8(str), font, color, wrap_point, stop_point, no_render, render_solid, start_index, end_index);
+}
+
+static void text_layout_push_line(TextLayout* layout, uint32_t start, uint32_t end, uint32_t first_index, uint32_t first_glyph, 
+                                  float width) {
+  if(layout->line_count >= layout->line_cap) {
+    // Lines live in the frame arena, growing copies them into a larger block
+    uint32_t cap = layout->line_cap ? layout->line_cap * 2 : 16;
+    TextLine* lines = (TextLine*)arena_alloc(sizeof(TextLine) * cap);
+    if(layout->line_count) 
+      memcpy(lines, layout->lines, sizeof(TextLine) * layout->line_count);
+    layout->lines = lines;
+    layout->line_cap = cap;
   }
-
-  // Local variables needed for rendering
-  LfTextProps ret = {0};
-  float x = pos.x;
-  float y = pos.y;
-
-  int32_t max_descended_char_height = get_max_char_height_font(font);
-
-  float last_x = x;
-
-  float height = get_max_char_height_font(font);
-  float width = 0;
-
-  uint32_t i = 0;
-  while (str[i] != L'\0') {
-    if (str[i] >= font.num_glyphs) {
+  layout->lines[layout->line_count++] = (TextLine){
+    .start = start, .end = end, .first_index = first_index, .first_glyph = first_glyph, .width = width
+  };
+  if(width > layout->width) 
+    layout->width = width;
+}
+
+TextLayout text_layout(const char* str, const LfFont* font, float max_width, int32_t end_index) {
+  // Greedy word wrapping in a single pass. Lines break after the last space that still fits, 
+  // words that are wider than a whole line are broken between characters.
+  TextLayout layout = {0};
+  if(font->mono_advance != 0.0f && text_layout_mono(str, font, max_width, end_index, &layout)) 
+    return layout;
+  layout = (TextLayout){0};
+  const uint8_t* s = (const uint8_t*)str;
+  const float render_scale = font->render_scale;
+  bool wrap = max_width >= 0.0f;
+
+  uint32_t line_start = 0, line_index = 0, line_glyph = 0;
+  float x = 0.0f;
+  // Last break opportunity on the current line (after a space)
+  uint32_t brk = 0, brk_index = 0, brk_glyph = 0;
+  float brk_x = 0.0f;
+
+  uint32_t b = 0, i = 0;
+  while(s[b] != '\0') {
+    uint32_t cp_len = 1;
+    uint32_t cp = s[b] < 0x80 ? s[b] : utf8_decode(&s[b], &cp_len);
+    const LfGlyph* glyph = font_glyph(font, cp);
+    if(cp != '\n' && !glyph) {
+      b += cp_len;
       i++;
       continue;
     }
-    if (stbtt_FindGlyphIndex((const stbtt_fontinfo*)font.font_info, str[i] - 32) == 0 && 
-      str[i] != L' ' && str[i] != L'\n' && str[i] != L'\t' && !iswdigit(str[i]) && !iswpunct(str[i])) {
+    if(i >= end_index && end_index != -1) break;
+
+    if(cp == '\n') {
+      text_layout_push_line(&layout, line_start, b, line_index, line_glyph, x);
+      b += cp_len;
       i++;
+      line_start = brk = b;
+      line_index = brk_index = i;
+      line_glyph = brk_glyph = layout.glyph_count;
+      x = 0.0f;
       continue;
     }
-    if (i >= end_index && end_index != -1) {
-      break;
-    }
 
-    // Calculate the width of the next word
-    float word_width = 0;
-    uint32_t j = i;
-    while (str[j] != L' ' && str[j] != L'\n' && str[j] != L'\0') {
-      stbtt_aligned_quad q;
-      stbtt_GetBakedQuad((stbtt_bakedchar*)font.cdata, font.tex_width, font.tex_height, str[j] - 32, &word_width, &y, &q, 0);
-      j++;
+    float advance = glyph->advance * render_scale;
+    if(cp != ' ' && wrap && x + advance > max_width && b > line_start) {
+      if(brk > line_start) {
+        // Moving the current word onto the next line
+        text_layout_push_line(&layout, line_start, brk, line_index, line_glyph, brk_x);
+        line_start = brk;
+        line_index = brk_index;
+        line_glyph = brk_glyph;
+        x -= brk_x;
+      } else {
+        text_layout_push_line(&layout, line_start, b, line_index, line_glyph, x);
+        line_start = brk = b;
+        line_index = brk_index = i;
+        line_glyph = brk_glyph = layout.glyph_count;
+        x = 0.0f;
+      }
     }
 
-    // If the next word exceeds the wrap point, move to the next line
-    if (x + word_width > wrap_point && wrap_point != -1) {
-      y += font.font_size;
-      height += font.font_size;
-      if (x - pos.x > width) {
-        width = x - pos.x;
+    x += advance;
+    layout.glyph_count++;
+    b += cp_len;
+    i++;
+    if(cp == ' ') {
+      brk = b;
+      brk_index = i;
+      brk_glyph = layout.glyph_count;
+      brk_x = x;
+    }
+  }
+  text_layout_push_line(&layout, line_start, b, line_index, line_glyph, x);
+  return layout;
+}
+
+bool text_layout_mono(const char* str, const LfFont* font, float max_width, int32_t end_index, TextLayout* layout) {
+  // Same wrapping as text_layout() on whole columns, fails for text that isn't printable ASCII
+  const uint8_t* s = (const uint8_t*)str;
+  const float advance = font->mono_advance * font->render_scale;
+  uint32_t max_cols = max_width >= 0.0f ? (uint32_t)(max_width / advance) : UINT32_MAX;
+
+  uint32_t line_start = 0, line_glyph = 0;
+  uint32_t brk = 0, brk_glyph = 0;
+  uint32_t b = 0;
+  for(; s[b] != '\0'; b++) {
+    if((s[b] < ' ' && s[b] != '\n') || s[b] > '~') return false;
+    if(b >= (uint32_t)end_index && end_index != -1) break;
+
+    if(s[b] == '\n') {
+      text_layout_push_line(layout, line_start, b, line_start, line_glyph, (float)(b - line_start) * advance);
+      line_start = brk = b + 1;
+      line_glyph = brk_glyph = layout->glyph_count;
+      continue;
+    }
+    if(s[b] != ' ' && b - line_start >= max_cols && b > line_start) {
+      if(brk > line_start) {
+        text_layout_push_line(layout, line_start, brk, line_start, line_glyph, (float)(brk - line_start) * advance);
+        line_start = brk;
+        line_glyph = brk_glyph;
+      } else {
+        text_layout_push_line(layout, line_start, b, line_start, line_glyph, (float)(b - line_start) * advance);
+        line_start = brk = b;
+        line_glyph = brk_glyph = layout->glyph_count;
       }
-      x = pos.x;
-      last_x = x;
     }
+    layout->glyph_count++;
+    if(s[b] == ' ') {
+      brk = b + 1;
+      brk_glyph = layout->glyph_count;
+    }
+  }
+  text_layout_push_line(layout, line_start, b, line_start, line_glyph, (float)(b - line_start) * advance);
+  layout->mono = true;
+  return true;
+}
+
+LfTextProps text_layout_emit(const TextLayout* layout, vec2s pos, const char* str, const LfFont* font, LfColor color, 
+                             vec2s stop_point, bool no_render, bool render_solid, int32_t start_index) {
+  bool emit = !no_render && state.renderer_render;
+
+  // Without a stop point only the lines within the clipping area are walked
+  uint32_t first = 0, last = layout->line_count;
+  bool cull_lines = stop_point.y == -1;
+  if(cull_lines) {
+    if(emit) text_visible_lines(pos.y, font, layout->line_count, &first, &last);
+    else first = last = 0;
+    if(emit && first == last) 
+      state.render.stats.culled++;
+  }
+
+  // Retrieving the texture index
+  uint16_t tex_index = LF_NO_TEXTURE;
+  if (emit && first != last) 
+    tex_index = renderer_tex_slot(font->bitmap);
+
+  const float max_char_height = font->max_char_height;
+  const float render_scale = font->render_scale;
+  const int32_t max_descended_char_height = (int32_t)max_char_height;
+  const uint8_t* s = (const uint8_t*)str;
 
-    // If the current character is a new line, advance to the next line
-    if (str[i] == L'\n') {
-      y += font.font_size;
-      height += font.font_size;
-      if (x - pos.x > width) {
-        width = x - pos.x;
+  LfTextProps ret = {0};
+  float x = pos.x, y = pos.y;
+  float width = 0.0f;
+  uint32_t l = first;
+  for(; l < last; l++) {
+    const TextLine* line = &layout->lines[l];
+    y = pos.y + (float)l * font->font_size;
+    x = pos.x;
+    float last_x = x;
+
+    uint32_t b = line->start, i = line->first_index;
+    bool stopped = false;
+    while(b < line->end) {
+      uint32_t cp_len = 1;
+      uint32_t cp = s[b] < 0x80 ? s[b] : utf8_decode(&s[b], &cp_len);
+      LfGlyph* glyph = font_glyph(font, cp);
+      if(!glyph) {
+        b += cp_len;
+        i++;
+        continue;
       }
-      x = pos.x;
-      last_x = x;
-      i++;
-      continue;
-    }
 
-    // Retrieving the vertex data of the current character & submitting it to the batch
-    stbtt_aligned_quad q;
-    stbtt_GetBakedQuad((stbtt_bakedchar*)font.cdata, font.tex_width, font.tex_height, str[i] - 32, &x, &y, &q, 1);
-    if (i < start_index && start_index != -1) {
-      last_x = x;
-      ret.rendered_count++;
-      i++;
-      continue;
-    }
-    if (stop_point.x != -1 && stop_point.y != -1) {
-      if (x >= stop_point.x && stop_point.x != -1 && y + get_max_char_height_font(font) >= stop_point.y && stop_point.y != -1) {
-        break;
+      // Positioning the quad of the glyph on whole pixels & advancing the pen
+      float qx = floorf(x + glyph->xoff * render_scale + 0.5f);
+      float qy = floorf(y + glyph->yoff * render_scale + 0.5f);
+      x += glyph->advance * render_scale;
+      b += cp_len;
+      if (i++ < start_index && start_index != -1) {
+        last_x = x;
+        ret.rendered_count++;
+        continue;
       }
-    } else {
-      if (y + get_max_char_height_font(font) >= stop_point.y && stop_point.y != -1) {
+      if (stop_point.y != -1 && y + max_char_height >= stop_point.y && (stop_point.x == -1 || x >= stop_point.x)) {
+        stopped = true;
         break;
       }
-    }
-    if (!culled && !no_render && state.renderer_render) {
-      if (render_solid) {
-        lf_rect_render((vec2s){x, y}, (vec2s){last_x - x, get_max_char_height_font(font)}, color, LF_NO_COLOR, 0.0f, 0.0f);
-      } else {
-        renderer_add_glyph(q, max_descended_char_height, color, tex_index);
+      if (emit) {
+        if (render_solid) {
+          lf_rect_render((vec2s){x, y}, (vec2s){last_x - x, max_char_height}, color, LF_NO_COLOR, 0.0f, 0.0f);
+        } else if(glyph_atlas_ensure(font, glyph)) {
+          renderer_add_glyph(font, glyph, qx, qy + max_descended_char_height, color, tex_index);
+        }
+        last_x = x;
       }
-      last_x = x;
+      ret.rendered_count++;
     }
-    ret.rendered_count++;
-    i++;
+    if (x - pos.x > width) 
+      width = x - pos.x;
+    if (stopped) break;
   }
 
-  // Populating the return value
-  if (x - pos.x > width) {
-    width = x - pos.x;
+  // Culled lines don't change the metrics, those are known from the line table
+  if(cull_lines) {
+    const TextLine* line = &layout->lines[layout->line_count - 1];
+    ret.width = layout->width;
+    ret.height = max_char_height + (float)(layout->line_count - 1) * font->font_size;
+    ret.end_x = pos.x + line->width;
+    ret.end_y = pos.y + (float)(layout->line_count - 1) * font->font_size;
+    ret.rendered_count = layout->glyph_count;
+    return ret;
   }
+
+  // Populating the return value
+  uint32_t lines_reached = l < layout->line_count ? l + 1 : layout->line_count;
   ret.width = width;
-  ret.height = height;
+  ret.height = max_char_height + (float)(lines_reached - 1) * font->font_size;
   ret.end_x = x;
   ret.end_y = y;
   return ret;
- }
+}
 
-void lf_rect_render(vec2s pos, vec2s size, LfColor color, LfColor border_color, float border_width, float corner_radius) {
-  if(!state.renderer_render) return;
-  if(item_should_cull((LfAABB){.pos = pos, .size = size})) {
-    return;
+void text_visible_lines(float y, const LfFont* font, uint32_t line_count, uint32_t* first, uint32_t* last) {
+  // Lines are a font size apart, glyphs reach at most one line above their line & below its baseline
+  float clip_y0 = state.cull_start.y == -1 ? 0.0f : state.cull_start.y;
+  float clip_y1 = state.cull_end.y == -1 ? (float)state.render.list.display_height : state.cull_end.y;
+  float line_height = (float)font->font_size;
+  float top = floorf((clip_y0 - y - font->max_char_height - line_height) / line_height);
+  float bottom = floorf((clip_y1 - y + line_height) / line_height) + 1.0f;
+  *first = top <= 0.0f ? 0 : top >= (float)line_count ? line_count : (uint32_t)top;
+  *last = bottom <= (float)*first ? *first : bottom >= (float)line_count ? line_count : (uint32_t)bottom;
+}
+
+void text_cache_lru_unlink(uint32_t index) {
+  TextCache* cache = &state.text_cache;
+  TextCacheEntry* entry = &cache->entries[index];
+  if(entry->lru_prev != LF_TEXT_CACHE_NONE) cache->entries[entry->lru_prev].lru_next = entry->lru_next;
+  else cache->lru_head = entry->lru_next;
+  if(entry->lru_next != LF_TEXT_CACHE_NONE) cache->entries[entry->lru_next].lru_prev = entry->lru_prev;
+  else cache->lru_tail = entry->lru_prev;
+}
+
+void text_cache_lru_push(uint32_t index) {
+  TextCache* cache = &state.text_cache;
+  TextCacheEntry* entry = &cache->entries[index];
+  entry->lru_prev = LF_TEXT_CACHE_NONE;
+  entry->lru_next = cache->lru_head;
+  if(cache->lru_head != LF_TEXT_CACHE_NONE) cache->entries[cache->lru_head].lru_prev = index;
+  cache->lru_head = index;
+  if(cache->lru_tail == LF_TEXT_CACHE_NONE) cache->lru_tail = index;
+}
+
+void text_cache_remove(uint32_t index) {
+  TextCache* cache = &state.text_cache;
+  TextCacheEntry* entry = &cache->entries[index];
+  uint32_t* link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+  while(*link != index) 
+    link = &cache->entries[*link].bucket_next;
+  *link = entry->bucket_next;
+  text_cache_lru_unlink(index);
+
+  cache->bytes -= entry->bytes;
+  mem_free(entry->str);
+  mem_free(entry->carets);
+  memset(entry, 0, sizeof(*entry));
+  entry->bucket_next = cache->free_head;
+  cache->free_head = index;
+  cache->entry_count--;
+}
+
+void text_cache_rehash(uint32_t bucket_count) {
+  TextCache* cache = &state.text_cache;
+  mem_free(cache->buckets);
+  cache->buckets = (uint32_t*)mem_alloc(sizeof(uint32_t) * bucket_count, LF_MEM_TEXT_CACHE);
+  memset(cache->buckets, 0xff, sizeof(uint32_t) * bucket_count);
+  cache->bucket_count = bucket_count;
+  for(uint32_t i = cache->lru_head; i != LF_TEXT_CACHE_NONE; i = cache->entries[i].lru_next) {
+    uint32_t* bucket = &cache->buckets[cache->entries[i].hash & (bucket_count - 1)];
+    cache->entries[i].bucket_next = *bucket;
+    *bucket = i;
+  }
+}
+
+void text_cache_place_glyphs(TextCacheEntry* entry, const LfFont* font) {
+  // Positioning the glyphs relative to the origin
+  const float max_descended_char_height = (float)(int32_t)font->max_char_height;
+  const uint8_t* s = (const uint8_t*)entry->str;
+  uint32_t g = 0;
+  for(uint32_t l = 0; l < entry->line_count; l++) {
+    const TextLine* line = &entry->lines[l];
+    float x = 0.0f;
+    float y = (float)l * font->font_size;
+    for(uint32_t b = line->start; b < line->end;) {
+      uint32_t cp_len = 1;
+      uint32_t cp = s[b] < 0x80 ? s[b] : utf8_decode(&s[b], &cp_len);
+      b += cp_len;
+      LfGlyph* glyph = font_glyph(font, cp);
+      if(!glyph) continue;
+      entry->glyphs[g++] = (TextCacheGlyph){
+        .x = x + glyph->xoff * font->render_scale, .y = y + glyph->yoff * font->render_scale + max_descended_char_height, 
+        .glyph = glyph
+      };
+      x += glyph->advance * font->render_scale;
+    }
+  }
+}
+
+TextCacheEntry* text_cache_insert(const char* str, uint32_t len, uint64_t hash, const LfFont* font, float wrap_width) {
+  TextCache* cache = &state.text_cache;
+  TextLayout layout = text_layout(str, font, wrap_width, -1);
+
+  size_t str_size = (len + 16) & ~(size_t)15;
+  size_t lines_size = sizeof(TextLine) * layout.line_count;
+  // The glyphs follow the lines & hold pointers, so they start at their own alignment
+  size_t glyphs_offset = (lines_size + _Alignof(TextCacheGlyph) - 1) & ~(_Alignof(TextCacheGlyph) - 1);
+  size_t bytes = str_size + glyphs_offset + sizeof(TextCacheGlyph) * layout.glyph_count;
+  // Long texts only keep their line table, the visible lines are laid out from the string when emitted
+  bool keep_glyphs = bytes <= cache->capacity / 4;
+  if(!keep_glyphs) 
+    bytes = str_size + lines_size;
+  if(bytes > cache->capacity) return NULL;
+
+  // Evicting the least recently used layouts until the new one fits, layouts that were used in 
+  // this frame stay (lf_text_layout() hands out pointers to them)
+  while(cache->bytes + bytes > cache->capacity && cache->lru_tail != LF_TEXT_CACHE_NONE) {
+    if(cache->entries[cache->lru_tail].frame == cache->frame) return NULL;
+    text_cache_remove(cache->lru_tail);
   }
-  // Offsetting the postion, so that pos is the top left of the rendered object
-  vec2s pos_initial = pos;
-  pos = (vec2s){pos.x + size.x / 2.0f, pos.y + size.y / 2.0f};
 
-  // Initializing texture coords data
-  vec2s texcoords[4] = {
-    (vec2s){1.0f, 1.0f},
-    (vec2s){1.0f, 0.0f},
-    (vec2s){0.0f, 0.0f},
-    (vec2s){0.0f, 1.0f},
+  if(cache->free_head == LF_TEXT_CACHE_NONE) {
+    uint32_t cap = cache->entry_cap ? cache->entry_cap * 2 : 64;
+    cache->entries = (TextCacheEntry*)mem_realloc(cache->entries, sizeof(TextCacheEntry) * cap, LF_MEM_TEXT_CACHE);
+    for(uint32_t i = cap; i > cache->entry_cap; i--) {
+      cache->entries[i - 1].bucket_next = cache->free_head;
+      cache->free_head = i - 1;
+    }
+    cache->entry_cap = cap;
+    text_cache_rehash(cap);
+  }
+  uint32_t index = cache->free_head;
+  cache->free_head = cache->entries[index].bucket_next;
+
+  TextCacheEntry* entry = &cache->entries[index];
+  *entry = (TextCacheEntry){
+    .hash = hash, .font_id = font->id, .font_size = font->font_size, .wrap_width = wrap_width, .len = len,
+    .line_count = layout.line_count, .glyph_count = layout.glyph_count, 
+    .width = layout.width, .mono = layout.mono, .bytes = bytes, .frame = cache->frame
   };
-  // Calculating the transform matrix
-  mat4 translate; 
-  mat4 scale;
-  mat4 transform;
-  vec3 pos_xyz = {(corner_radius != 0.0f ? (float)state.dsp_w / 2.0f : pos.x), (corner_radius != 0.0f ? (float)state.dsp_h / 2.0f : pos.y), 0.0f};
-  vec3 size_xyz = {corner_radius != 0.0f ? state.dsp_w : size.x, corner_radius != 0.0f ? state.dsp_h : size.y, 0.0f};
-  glm_translate_make(translate, pos_xyz);
-  glm_scale_make(scale, size_xyz);
-  glm_mat4_mul(translate,scale,transform);
-
-  // Adding the vertices to the batch renderer
-  for(uint32_t i = 0; i < 4; i++) {
-    if(state.render.vert_count >= MAX_RENDER_BATCH) {
-      renderer_flush();
-      renderer_begin();
+  entry->str = (char*)mem_alloc(bytes, LF_MEM_TEXT_CACHE);
+  entry->lines = (TextLine*)(entry->str + str_size);
+  memcpy(entry->str, str, len + 1);
+  memcpy(entry->lines, layout.lines, lines_size);
+
+  const TextLine* last = &layout.lines[layout.line_count - 1];
+  entry->height = font->max_char_height + (float)(layout.line_count - 1) * font->font_size;
+  entry->end_x = last->width;
+  entry->end_y = (float)(layout.line_count - 1) * font->font_size;
+  if(keep_glyphs) {
+    entry->glyphs = (TextCacheGlyph*)((uint8_t*)entry->lines + glyphs_offset);
+    text_cache_place_glyphs(entry, font);
+  }
+
+  uint32_t* bucket = &cache->buckets[hash & (cache->bucket_count - 1)];
+  entry->bucket_next = *bucket;
+  *bucket = index;
+  text_cache_lru_push(index);
+  cache->entry_count++;
+  cache->bytes += bytes;
+  return entry;
+}
+
+TextCacheEntry* text_cache_get(const char* str, const LfFont* font, float wrap_width) {
+  TextCache* cache = &state.text_cache;
+  if(!cache->capacity || !font->glyph_pages) return NULL;
+  if(wrap_width < 0.0f) wrap_width = -1.0f;
+
+  uint32_t len = strlen(str);
+  uint64_t hash = djb2_hash(DJB2_INIT, str, len);
+  hash ^= ((uint64_t)font->id << 32 | font->font_size) * 0x9E3779B97F4A7C15ull;
+  uint32_t wrap_bits;
+  memcpy(&wrap_bits, &wrap_width, sizeof(wrap_bits));
+  hash ^= (uint64_t)wrap_bits * 0xC2B2AE3D27D4EB4Full;
+  hash ^= hash >> 29;
+
+  if(cache->bucket_count) {
+    for(uint32_t i = cache->buckets[hash & (cache->bucket_count - 1)]; i != LF_TEXT_CACHE_NONE; i = cache->entries[i].bucket_next) {
+      TextCacheEntry* entry = &cache->entries[i];
+      if(entry->hash != hash || entry->len != len || entry->font_id != font->id || entry->font_size != font->font_size || 
+        entry->wrap_width != wrap_width || memcmp(entry->str, str, len) != 0) continue;
+      text_cache_lru_unlink(i);
+      text_cache_lru_push(i);
+      entry->frame = cache->frame;
+      state.render.stats.text_cache_hits++;
+      return entry;
     }
-    vec4 result;
-    glm_mat4_mulv(transform, state.render.vert_pos[i].raw, result);
-    state.render.verts[state.render.vert_count].pos[0] = result[0];
-    state.render.verts[state.render.vert_count].pos[1] = result[1];
+  }
+  state.render.stats.text_cache_misses++;
+  uint64_t* admit = &cache->admit[hash % LF_TEXT_CACHE_ADMIT_SLOTS];
+  if(*admit != hash) {
+    *admit = hash;
+    return NULL;
+  }
+  return text_cache_insert(str, len, hash, font, wrap_width);
+}
+
+LfTextProps text_cache_emit(const TextCacheEntry* entry, vec2s pos, const LfFont* font, LfColor color, bool no_render) {
+  LfTextProps ret = {
+    .width = entry->width, .height = entry->height, 
+    .end_x = pos.x + entry->end_x, .end_y = pos.y + entry->end_y, 
+    .rendered_count = entry->glyph_count
+  };
+  if(no_render || !state.renderer_render) return ret;
+
+  if(!entry->glyphs) {
+    TextLayout layout = {
+      .lines = entry->lines, .line_count = entry->line_count, .line_cap = entry->line_count, 
+      .glyph_count = entry->glyph_count, .width = entry->width
+    };
+    text_layout_emit(&layout, pos, entry->str, font, color, (vec2s){-1, -1}, false, false, -1);
+    return ret;
+  }
 
-    vec4s border_color_zto = lf_color_to_zto(border_color);
-    const vec4 border_color_arr = {border_color_zto.r, border_color_zto.g, border_color_zto.b, border_color_zto.a};
-    memcpy(state.render.verts[state.render.vert_count].border_color, border_color_arr, sizeof(vec4));
+  // Only the lines within the clipping area are emitted
+  uint32_t first, last;
+  text_visible_lines(pos.y, font, entry->line_count, &first, &last);
+  if(first == last) {
+    state.render.stats.culled++;
+    return ret;
+  }
 
-    state.render.verts[state.render.vert_count].border_width = border_width; 
+  // Translating the cached quads of the visible lines to the origin, glyphs evicted from the atlas are rasterized again
+  uint16_t tex_index = renderer_tex_slot(font->bitmap);
+  uint32_t glyph_end = last < entry->line_count ? entry->lines[last].first_glyph : entry->glyph_count;
+  for(uint32_t i = entry->lines[first].first_glyph; i < glyph_end; i++) {
+    const TextCacheGlyph* g = &entry->glyphs[i];
+    if(!glyph_atlas_ensure(font, g->glyph)) continue;
+    renderer_add_glyph(font, g->glyph, floorf(pos.x + g->x + 0.5f), floorf(pos.y + g->y + 0.5f), color, tex_index);
+  }
+  return ret;
+}
 
-    vec4s color_zto = lf_color_to_zto(color);
-    const vec4 color_arr = {color_zto.r, color_zto.g, color_zto.b, color_zto.a};
-    memcpy(state.render.verts[state.render.vert_count].color, color_arr, sizeof(vec4));
+void text_cache_purge_font(uint32_t font_id) {
+  TextCache* cache = &state.text_cache;
+  uint32_t i = cache->lru_head;
+  while(i != LF_TEXT_CACHE_NONE) {
+    uint32_t next = cache->entries[i].lru_next;
+    if(cache->entries[i].font_id == font_id) 
+      text_cache_remove(i);
+    i = next;
+  }
+}
 
-    const vec2 texcoord_arr = {texcoords[i].x, texcoords[i].y};
-    memcpy(state.render.verts[state.render.vert_count].texcoord, texcoord_arr, sizeof(vec2));
+void text_carets(const TextLine* lines, uint32_t line_count, const char* str, const LfFont* font, 
+                 float* carets, uint32_t* caret_starts) {
+  // Prefix sums of the advances of every line, carets has to hold (bytes + line_count) entries
+  const uint8_t* s = (const uint8_t*)str;
+  const float render_scale = font->render_scale;
+  uint32_t c = 0;
+  for(uint32_t l = 0; l < line_count; l++) {
+    caret_starts[l] = c;
+    float x = 0.0f;
+    for(uint32_t b = lines[l].start; b < lines[l].end;) {
+      uint32_t cp_len = 1;
+      uint32_t cp = s[b] < 0x80 ? s[b] : utf8_decode(&s[b], &cp_len);
+      b += cp_len;
+      carets[c++] = x;
+      const LfGlyph* glyph = font_glyph(font, cp);
+      if(glyph) x += glyph->advance * render_scale;
+    }
+    carets[c++] = x;
+  }
+  caret_starts[line_count] = c;
+}
+
+const LfTextLayout* lf_text_layout(const char* str, const LfFont* font, float wrap_width) {
+  LfTextLayout* ret = (LfTextLayout*)arena_alloc(sizeof(LfTextLayout));
+  ret->line_height = font->font_size;
+  ret->advance = 0.0f;
+
+  // Reusing the line table & the carets of a cached layout
+  TextCacheEntry* entry = text_cache_get(str, font, wrap_width);
+  if(entry) {
+    if(entry->mono) {
+      ret->lines = entry->lines;
+      ret->line_count = entry->line_count;
+      ret->carets = NULL;
+      ret->caret_starts = NULL;
+      ret->advance = font->mono_advance * font->render_scale;
+      return ret;
+    }
+    ret->lines = entry->lines;
+    ret->line_count = entry->line_count;
+    if(!entry->carets) {
+      // Attaching the carets to the entry if they fit into the cache after evicting layouts 
+      // of earlier frames (the entry itself was used in this frame), otherwise they only live 
+      // in the frame arena
+      TextCache* cache = &state.text_cache;
+      size_t carets_size = sizeof(float) * (entry->len + entry->line_count);
+      size_t bytes = carets_size + sizeof(uint32_t) * (entry->line_count + 1);
+      while(cache->bytes + bytes > cache->capacity && cache->lru_tail != LF_TEXT_CACHE_NONE &&
+        cache->entries[cache->lru_tail].frame != cache->frame) 
+        text_cache_remove(cache->lru_tail);
+      if(cache->bytes + bytes > cache->capacity) {
+        float* carets = (float*)arena_alloc(carets_size);
+        uint32_t* caret_starts = (uint32_t*)arena_alloc(sizeof(uint32_t) * (entry->line_count + 1));
+        text_carets(entry->lines, entry->line_count, entry->str, font, carets, caret_starts);
+        ret->carets = carets;
+        ret->caret_starts = caret_starts;
+        return ret;
+      }
+      entry->carets = (float*)mem_alloc(bytes, LF_MEM_TEXT_CACHE);
+      entry->caret_starts = (uint32_t*)((uint8_t*)entry->carets + carets_size);
+      text_carets(entry->lines, entry->line_count, entry->str, font, entry->carets, entry->caret_starts);
+      entry->bytes += bytes;
+      cache->bytes += bytes;
+    }
+    ret->carets = entry->carets;
+    ret->caret_starts = entry->caret_starts;
+    return ret;
+  }
 
-    state.render.verts[state.render.vert_count].tex_index = -1;
+  TextLayout layout = text_layout(str, font, wrap_width, -1);
+  ret->lines = layout.lines;
+  ret->line_count = layout.line_count;
+  if(layout.mono) {
+    ret->carets = NULL;
+    ret->caret_starts = NULL;
+    ret->advance = font->mono_advance * font->render_scale;
+    return ret;
+  }
+  float* carets = (float*)arena_alloc(sizeof(float) * (strlen(str) + layout.line_count));
+  uint32_t* caret_starts = (uint32_t*)arena_alloc(sizeof(uint32_t) * (layout.line_count + 1));
+  text_carets(layout.lines, layout.line_count, str, font, carets, caret_starts);
+  ret->carets = carets;
+  ret->caret_starts = caret_starts;
+  return ret;
+}
 
-    const vec2 scale_arr = {size.x, size.y};
-    memcpy(state.render.verts[state.render.vert_count].scale, scale_arr, sizeof(vec2));
+int32_t lf_text_hit_test(const LfTextLayout* layout, float x, float y) {
+  int32_t l = (int32_t)floorf(y / layout->line_height);
+  if(l < 0) l = 0;
+  if(l >= (int32_t)layout->line_count) l = layout->line_count - 1;
 
-    const vec2 pos_px_arr = {(float)pos_initial.x, (float)pos_initial.y};
-    memcpy(state.render.verts[state.render.vert_count].pos_px, pos_px_arr, sizeof(vec2));
+  // Monospaced characters are one advance apart
+  if(layout->advance != 0.0f) {
+    const TextLine* line = &layout->lines[l];
+    float k = floorf(x / layout->advance + 0.5f);
+    if(k < 0.0f) k = 0.0f;
+    if(k > (float)(line->end - line->start)) k = (float)(line->end - line->start);
+    return line->first_index + (int32_t)k;
+  }
 
-    state.render.verts[state.render.vert_count].corner_radius = corner_radius;
+  // Binary search for the first caret right of x, the closer one of it & its predecessor wins
+  const float* carets = &layout->carets[layout->caret_starts[l]];
+  uint32_t count = layout->caret_starts[l + 1] - layout->caret_starts[l];
+  uint32_t lo = 0, hi = count;
+  while(lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if(carets[mid] < x) lo = mid + 1;
+    else hi = mid;
+  }
+  if(lo == count) lo = count - 1;
+  else if(lo > 0 && x - carets[lo - 1] < carets[lo] - x) lo--;
+  return layout->lines[l].first_index + lo;
+}
+
+vec2s lf_text_index_to_pos(const LfTextLayout* layout, int32_t index) {
+  // Last line starting at or before index (wrapped lines share their boundary with the next line)
+  uint32_t lo = 0, hi = layout->line_count;
+  while(lo + 1 < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if((int32_t)layout->lines[mid].first_index <= index) lo = mid;
+    else hi = mid;
+  }
+  uint32_t count = layout->advance != 0.0f ? 
+    layout->lines[lo].end - layout->lines[lo].start + 1 : 
+    layout->caret_starts[lo + 1] - layout->caret_starts[lo];
+  int32_t k = index - (int32_t)layout->lines[lo].first_index;
+  if(k < 0) k = 0;
+  if(k >= (int32_t)count) k = count - 1;
+  float x = layout->advance != 0.0f ? (float)k * layout->advance : layout->carets[layout->caret_starts[lo] + k];
+  return (vec2s){x, lo * layout->line_height};
+}
+
+void text_cache_free() {
+  TextCache* cache = &state.text_cache;
+  while(cache->lru_tail != LF_TEXT_CACHE_NONE) 
+    text_cache_remove(cache->lru_tail);
+  mem_free(cache->entries);
+  mem_free(cache->buckets);
+  size_t capacity = cache->capacity;
+  memset(cache, 0, sizeof(*cache));
+  cache->capacity = capacity;
+  cache->free_head = cache->lru_head = cache->lru_tail = LF_TEXT_CACHE_NONE;
+}
 
-    const vec2 cull_start_arr = {state.cull_start.x, state.cull_start.y};
-    memcpy(state.render.verts[state.render.vert_count].min_coord, cull_start_arr, sizeof(vec2));
+LfTextProps lf_text_render(vec2s pos, const char* str, LfFont font, LfColor color, 
+                           int32_t wrap_point, vec2s stop_point, bool no_render, bool render_solid, int32_t start_index, int32_t end_index) {
+  float wrap_width = wrap_point != -1 ? wrap_point - pos.x : -1.0f;
+  bool measure = no_render && stop_point.x == -1 && stop_point.y == -1;
+
+  // Monospaced text is measured on its columns, that is cheaper than a cache lookup
+  TextLayout layout = {0};
+  if (!measure || font.mono_advance == 0.0f || !text_layout_mono(str, &font, wrap_width, end_index, &layout)) {
+    // Whole strings that are measured or rendered go through the layout cache
+    if (start_index == -1 && end_index == -1 && stop_point.x == -1 && stop_point.y == -1 && !render_solid) {
+      TextCacheEntry* entry = text_cache_get(str, &font, wrap_width);
+      if (entry) 
+        return text_cache_emit(entry, pos, &font, color, no_render);
+    }
+    layout = text_layout(str, &font, wrap_width, end_index);
+  }
 
-    const vec2 cull_end_arr = {state.cull_end.x, state.cull_end.y};
-    memcpy(state.render.verts[state.render.vert_count].max_coord, cull_end_arr, sizeof(vec2));
+  // Measuring only needs the line table
+  if (measure) {
+    const TextLine* last = &layout.lines[layout.line_count - 1];
+    return (LfTextProps){
+      .width = layout.width, 
+      .height = font.max_char_height + (float)(layout.line_count - 1) * font.font_size,
+      .end_x = pos.x + last->width,
+      .end_y = pos.y + (float)(layout.line_count - 1) * font.font_size,
+      .rendered_count = layout.glyph_count
+    };
+  }
+  return text_layout_emit(&layout, pos, str, &font, color, stop_point, no_render, render_solid, start_index);
+}
 
-    state.render.vert_count++;
+void lf_rect_render(vec2s pos, vec2s size, LfColor color, LfColor border_color, float border_width, float corner_radius) {
+  if(!state.renderer_render) return;
+  if(item_should_cull((LfAABB){.pos = pos, .size = size})) {
+    state.render.stats.culled++;
+    return;
   }
-  state.render.index_count += 6;
+  // Rounded rects are shaded through the SDF in the fragment shader which is evaluated 
+  // from the instance position & size, the vertex shader grows the quad by the smoothed edge.
+  LfPipeline pipeline = (border_width != 0.0f || corner_radius != 0.0f) ? LF_PIPELINE_SHAPE : LF_PIPELINE_SOLID;
+  renderer_add_instance(pos, size, (vec4s){0.0f, 0.0f, 1.0f, 1.0f}, color, border_color, border_width, corner_radius, 
+                        LF_NO_TEXTURE, pipeline);
 }
 
 void lf_image_render(vec2s pos, LfColor color, LfTexture tex, LfColor border_color, float border_width, float corner_radius) {
   if(!state.renderer_render) return;
   if(item_should_cull((LfAABB){.pos = pos, .size = (vec2s){tex.width, tex.height}})) {
+    state.render.stats.culled++;
     return;
   }
-  if(state.render.tex_count - 1 >= MAX_TEX_COUNT_BATCH - 1) {
-    renderer_flush();
-    renderer_begin();
-  }
-  // Offsetting the postion, so that pos is the top left of the rendered object
-  vec2s pos_initial = pos;
-  pos = (vec2s){pos.x + tex.width / 2.0f, pos.y + tex.height / 2.0f};
 
   if(state.image_color_stack.a != 0.0) {
     color = state.image_color_stack;
   }
-  // Initializing texture coords data
-  vec2s texcoords[4] = {
-    (vec2s){0.0f, 0.0f},
-    (vec2s){1.0f, 0.0f},
-    (vec2s){1.0f, 1.0f},
-    (vec2s){0.0f, 1.0f},
-  };
-  // Retrieving the texture index of the rendered texture
-  float tex_index = -1.0f;
-  for(uint32_t i = 0; i < state.render.tex_count; i++) {
-    if(tex.id == state.render.textures[i].id)  {
-      tex_index = i;
-      break;
-    }
+  // Images that live in the texture array don't need a texture slot
+  uint16_t tex_index;
+  vec4s texcoords = (vec4s){0.0f, 0.0f, 1.0f, 1.0f};
+  uint16_t layer;
+  vec2s uv_max;
+  if(state.render.backend.texture_layer && 
+    state.render.backend.texture_layer(state.render.backend.user_data, tex.id, &layer, &uv_max)) {
+    tex_index = LF_TEX_LAYER_BIT | layer;
+    texcoords.z = uv_max.x;
+    texcoords.w = uv_max.y;
+  } else {
+    tex_index = renderer_tex_slot(tex);
   }
-  if(tex_index == -1.0f) {
-    tex_index = (float)state.render.tex_index;
-    state.render.textures[state.render.tex_count++] = tex;
-    state.render.tex_index++;
-  }
-  // Calculating the transform
-  mat4 translate = GLM_MAT4_IDENTITY_INIT; 
-  mat4 scale = GLM_MAT4_IDENTITY_INIT;
-  mat4 transform = GLM_MAT4_IDENTITY_INIT;
-  vec3s pos_xyz = (vec3s){pos.x, pos.y, 0.0f};
-  vec3 tex_size;
-  tex_size[0] = tex.width;
-  tex_size[1] = tex.height;
-  tex_size[2] = 0;
-  glm_translate_make(translate, pos_xyz.raw);
-  glm_scale_make(scale, tex_size);
-  glm_mat4_mul(translate,scale,transform);
-
-  // Adding the vertices to the batch renderer
-  for(uint32_t i = 0; i < 4; i++) {
-    if(state.render.vert_count >= MAX_RENDER_BATCH) {
-      renderer_flush();
-      renderer_begin();
-    }
-    vec4 result;
-    glm_mat4_mulv(transform, state.render.vert_pos[i].raw, result);
-    memcpy(state.render.verts[state.render.vert_count].pos, result, sizeof(vec2));
-
-    vec4s border_color_zto = lf_color_to_zto(border_color);
-    const vec4 border_color_arr = {border_color_zto.r, border_color_zto.g, border_color_zto.b, border_color_zto.a};
-    memcpy(state.render.verts[state.render.vert_count].border_color, border_color_arr, sizeof(vec4));
-
-    state.render.verts[state.render.vert_count].border_width = border_width; 
 
-    vec4s color_zto = lf_color_to_zto(color);
-    const vec4 color_arr = {color_zto.r, color_zto.g, color_zto.b, color_zto.a};
-    memcpy(state.render.verts[state.render.vert_count].color, color_arr, sizeof(vec4));
-
-    const vec2 texcoord_arr = {texcoords[i].x, texcoords[i].y};
-    memcpy(state.render.verts[state.render.vert_count].texcoord, texcoord_arr, sizeof(vec2));
-
-    state.render.verts[state.render.vert_count].tex_index = tex_index;
-
-    const vec2 scale_arr = {(float)tex.width, (float)tex.height};
-    memcpy(state.render.verts[state.render.vert_count].scale, scale_arr, sizeof(vec2));
-
-    vec2 pos_px_arr = {(float)pos_initial.x, (float)pos_initial.y};
-    memcpy(state.render.verts[state.render.vert_count].pos_px, pos_px_arr, sizeof(vec2));
-
-    state.render.verts[state.render.vert_count].corner_radius = corner_radius;
-
-    const vec2 cull_start_arr = {state.cull_start.x, state.cull_start.y};
-    memcpy(state.render.verts[state.render.vert_count].min_coord, cull_start_arr, sizeof(vec2));
-
-    const vec2 cull_end_arr = {state.cull_end.x, state.cull_end.y};
-    memcpy(state.render.verts[state.render.vert_count].max_coord, cull_end_arr, sizeof(vec2));
-
-    state.render.vert_count++;
-  } 
-  state.render.index_count += 6;
+  // Recording the instance into the draw list
+  renderer_add_instance(pos, (vec2s){(float)tex.width, (float)tex.height}, texcoords, 
+                        color, border_color, border_width, corner_radius, tex_index, LF_PIPELINE_IMAGE);
 }
 
 bool lf_point_intersects_aabb(vec2s p, LfAABB aabb) {
@@ -3464,6 +6790,21 @@ void lf_unset_cull_end_y() {
   state.cull_end.y = -1;
 }
 
+void lf_push_clip_rect(LfAABB rect) {
+  clip_stack_push();
+  // Intersecting with the current clipping area (-1 = not clipped)
+  vec2s start = rect.pos;
+  vec2s end = (vec2s){rect.pos.x + rect.size.x, rect.pos.y + rect.size.y};
+  state.cull_start.x = state.cull_start.x == -1 ? start.x : fmaxf(state.cull_start.x, start.x);
+  state.cull_start.y = state.cull_start.y == -1 ? start.y : fmaxf(state.cull_start.y, start.y);
+  state.cull_end.x = state.cull_end.x == -1 ? end.x : fminf(state.cull_end.x, end.x);
+  state.cull_end.y = state.cull_end.y == -1 ? end.y : fminf(state.cull_end.y, end.y);
+}
+
+void lf_pop_clip_rect() {
+  clip_stack_pop();
+}
+
 void lf_set_image_color(LfColor color) {
   state.image_color_stack = color;
 }
@@ -3599,3 +6940,145 @@ char* lf_get_clipboard_text() {
 void lf_set_no_render(bool no_render) {
   state.renderer_render = !no_render;
 }
+
+uint64_t lf_get_frame_upload_bytes() {
+  return state.render.frame_stats.upload_bytes;
+}
+
+bool lf_vertex_streaming_enabled() {
+  return state.render.gl.streaming;
+}
+
+LfRenderBackend lf_gl_backend() {
+  return (LfRenderBackend){
+    .name = "opengl",
+    .init = gl_backend_init,
+    .terminate = gl_backend_terminate,
+    .resize = gl_backend_resize,
+    .render = gl_backend_render,
+    .create_texture = gl_backend_create_texture,
+    .update_texture = gl_backend_update_texture,
+    .delete_texture = gl_backend_delete_texture,
+    .texture_layer = gl_backend_texture_layer,
+    .instance_storage = gl_backend_instance_storage,
+  };
+}
+
+LfRenderBackend lf_null_backend() {
+  return (LfRenderBackend){
+    .name = "null",
+    .init = null_backend_init,
+    .render = null_backend_render,
+    .create_texture = null_backend_create_texture,
+  };
+}
+
+uint32_t lf_get_pipeline_instance_count(LfPipeline pipeline) {
+  if(pipeline >= LF_PIPELINE_COUNT) return 0;
+  return state.render.list.pipeline_counts[pipeline];
+}
+
+LfFrameStats lf_get_frame_stats() {
+  return state.render.frame_stats;
+}
+
+void lf_set_text_cache_capacity(size_t bytes) {
+  TextCache* cache = &state.text_cache;
+  cache->capacity = bytes;
+  while(cache->bytes > cache->capacity && cache->lru_tail != LF_TEXT_CACHE_NONE) 
+    text_cache_remove(cache->lru_tail);
+}
+
+void lf_clear_text_cache() {
+  text_cache_free();
+}
+
+const LfDrawList* lf_get_draw_list() {
+  return &state.render.list;
+}
+
+LfRenderBackend lf_software_backend(uint32_t thread_count) {
+  return (LfRenderBackend){
+    .name = "software",
+    .user_data = (void*)(uintptr_t)thread_count,
+    .init = sw_backend_init,
+    .terminate = sw_backend_terminate,
+    .resize = sw_backend_resize,
+    .render = sw_backend_render,
+    .create_texture = sw_backend_create_texture,
+    .update_texture = sw_backend_update_texture,
+    .delete_texture = sw_backend_delete_texture,
+  };
+}
+
+void lf_software_set_clear_color(LfColor color) {
+  state.render.sw.clear_color = color;
+}
+
+const uint8_t* lf_software_get_framebuffer(uint32_t* width, uint32_t* height) {
+  if(width) *width = state.render.sw.width;
+  if(height) *height = state.render.sw.height;
+  return state.render.sw.pixels;
+}
+
+bool lf_software_write_png(const char* filepath) {
+  SoftwareBackendState* sw = &state.render.sw;
+  if(!sw->pixels) {
+    LF_ERROR("Trying to write a PNG without rendering with the software backend.");
+    return false;
+  }
+  FILE* file = fopen(filepath, "wb");
+  if(!file) {
+    LF_ERROR("Failed to open '%s' for writing.", filepath);
+    return false;
+  }
+
+  // Scanlines with filter type 0 in uncompressed deflate blocks
+  size_t row_size = (size_t)sw->width * 4 + 1;
+  size_t raw_size = row_size * sw->height;
+  size_t block_count = (raw_size + 65534) / 65535;
+  size_t idat_size = 2 + raw_size + block_count * 5 + 4;
+  uint8_t* idat = (uint8_t*)mem_alloc(idat_size, LF_MEM_GENERAL);
+
+  uint8_t* out = idat;
+  *out++ = 0x78;
+  *out++ = 0x01;
+  uint32_t adler_a = 1, adler_b = 0;
+  size_t remaining = raw_size;
+  for(size_t i = 0; i < raw_size;) {
+    uint16_t len = remaining > 65535 ? 65535 : (uint16_t)remaining;
+    *out++ = (remaining == len);
+    *out++ = len & 0xff;
+    *out++ = len >> 8;
+    *out++ = ~len & 0xff;
+    *out++ = (~len >> 8) & 0xff;
+    for(uint16_t j = 0; j < len; j++, i++) {
+      size_t x = i % row_size;
+      uint8_t byte = x == 0 ? 0 : sw->pixels[(i / row_size) * (row_size - 1) + x - 1];
+      *out++ = byte;
+      adler_a = (adler_a + byte) % 65521;
+      adler_b = (adler_b + adler_a) % 65521;
+    }
+    remaining -= len;
+  }
+  uint32_t adler = (adler_b << 16) | adler_a;
+  *out++ = adler >> 24;
+  *out++ = adler >> 16;
+  *out++ = adler >> 8;
+  *out++ = adler;
+
+  uint8_t ihdr[13] = {
+    sw->width >> 24, sw->width >> 16, sw->width >> 8, sw->width, 
+    sw->height >> 24, sw->height >> 16, sw->height >> 8, sw->height,
+    8, 6, 0, 0, 0 // 8 bit RGBA
+  };
+  const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  fwrite(signature, 1, 8, file);
+  png_write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+  png_write_chunk(file, "IDAT", idat, (uint32_t)(out - idat));
+  png_write_chunk(file, "IEND", NULL, 0);
+
+  mem_free(idat);
+  fclose(file);
+  return true;
+}